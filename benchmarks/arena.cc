@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <httpxx/arena.hh>
+#include <httpxx/request_handlers.hh>
+#include <httpxx/router.hh>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "harness.hh"
+
+namespace {
+std::atomic<std::size_t> allocations{0};
+}
+
+// Counts every global allocation; std::pmr::new_delete_resource() goes
+// through the aligned overloads.
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto alignment = static_cast<std::size_t>(align);
+  if (void* p = std::aligned_alloc(alignment,
+                                   (size + alignment - 1) & ~(alignment - 1))) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+constexpr std::string_view headers =
+
+    "Host: localhost:6969\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:131.0)\r\n"
+    "Accept: application/json\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=8f2c1a9d\r\n"
+    "\r\n";
+
+const std::string health_request =
+    "GET /api/health?probe=1 HTTP/1.1\r\n" + std::string(headers);
+const std::string tasks_request =
+    "GET /api/tasks?status=pending&limit=20 HTTP/1.1\r\n" +
+    std::string(headers);
+
+struct Result {
+  double allocations_per_request;
+  double p50_ns;
+  double p99_ns;
+};
+
+Result measure(const httpxx::Router& router, const httpxx::Config& config,
+               std::string_view request, httpxx::RequestArena* arena,
+               std::size_t requests) {
+  using clock = std::chrono::steady_clock;
+  std::vector<double> latencies;
+  latencies.reserve(requests);
+
+  const auto before = allocations.load();
+  for (std::size_t i = 0; i < requests; ++i) {
+    auto* resource =
+        arena ? arena->resource() : std::pmr::new_delete_resource();
+    const auto start = clock::now();
+    {
+      auto response =
+          httpxx::RequestHandler::respond(router, config, request, resource);
+      std::pmr::string head(resource);
+      response.appendHead(head);
+      httpxx::bench::doNotOptimize(head);
+    }
+    if (arena) {
+      arena->reset();
+    }
+    latencies.push_back(
+        std::chrono::duration<double, std::nano>(clock::now() - start)
+            .count());
+  }
+  const auto total = allocations.load() - before;
+
+  std::ranges::sort(latencies);
+  return {static_cast<double>(total) / requests, latencies[requests / 2],
+          latencies[requests * 99 / 100]};
+}
+
+}  // namespace
+
+int main() {
+  auto router =
+      httpxx::RouterBuilder()
+          .get("/api/health",
+               [](const httpxx::Request&) {
+                 return httpxx::ResponseBuilder::ok().text("ok").build();
+               })
+          .get("/api/tasks",
+               [](const httpxx::Request& req) {
+                 nlohmann::json tasks = nlohmann::json::array();
+                 tasks.push_back({{"id", "1a2b3c4d"},
+                                  {"title", "Write benchmarks"},
+                                  {"status", req.request_parameters.at(
+                                                 "status")}});
+                 return httpxx::ResponseBuilder::ok().json(tasks).build();
+               })
+          .build();
+  httpxx::Config config;
+
+  constexpr std::size_t requests = 200000;
+  httpxx::RequestArena arena;
+
+  fmt::print("{:<24} {:>12} {:>10} {:>10}\n", "request / resource",
+             "allocs/req", "p50 ns", "p99 ns");
+  for (const auto& [name, request] :
+       {std::pair{"/api/health", std::string_view(health_request)},
+        std::pair{"/api/tasks", std::string_view(tasks_request)}}) {
+    measure(router, config, request, &arena, 1000);
+    const auto heap = measure(router, config, request, nullptr, requests);
+    const auto pooled = measure(router, config, request, &arena, requests);
+
+    fmt::print("{:<24} {:>12.1f} {:>10.0f} {:>10.0f}\n",
+               fmt::format("{} new/delete", name),
+               heap.allocations_per_request, heap.p50_ns, heap.p99_ns);
+    fmt::print("{:<24} {:>12.1f} {:>10.0f} {:>10.0f}\n",
+               fmt::format("{} arena", name), pooled.allocations_per_request,
+               pooled.p50_ns, pooled.p99_ns);
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <array>
+#include <httpxx/enums.hh>
+#include <string>
+#include <unordered_map>
+
+#include "harness.hh"
+
+// The lookups enums.hh used before the perfect hash tables, kept here as the
+// baseline the new ones are measured against.
+namespace legacy {
+
+httpxx::HttpMethod stringToHttpMethod(const std::string& method) {
+  static const std::unordered_map<std::string, httpxx::HttpMethod> strToHM{
+      {"GET", httpxx::HttpMethod::GET},
+      {"HEAD", httpxx::HttpMethod::HEAD},
+      {"POST", httpxx::HttpMethod::POST},
+      {"PUT", httpxx::HttpMethod::PUT},
+      {"DELETE", httpxx::HttpMethod::DELETE},
+      {"CONNECT", httpxx::HttpMethod::CONNECT},
+      {"OPTIONS", httpxx::HttpMethod::OPTIONS},
+      {"TRACE", httpxx::HttpMethod::TRACE},
+      {"PATCH", httpxx::HttpMethod::PATCH}};
+  return strToHM.at(method);
+}
+
+httpxx::ContentType getContentTypeFromFilename(const std::string& filename) {
+  using httpxx::ContentType;
+  size_t dotPos = filename.find_last_of('.');
+  if (dotPos == std::string::npos || dotPos == filename.length() - 1) {
+    return ContentType::APPLICATION_OCTET_STREAM;
+  }
+
+  std::string extension = filename.substr(dotPos + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 ::tolower);
+
+  if (extension == "txt") return ContentType::TEXT_PLAIN;
+  if (extension == "html" || extension == "htm") return ContentType::TEXT_HTML;
+  if (extension == "css") return ContentType::TEXT_CSS;
+  if (extension == "js") return ContentType::TEXT_JAVASCRIPT;
+  if (extension == "json") return ContentType::APPLICATION_JSON;
+  if (extension == "xml") return ContentType::APPLICATION_XML;
+  if (extension == "pdf") return ContentType::APPLICATION_PDF;
+  if (extension == "csv") return ContentType::TEXT_CSV;
+  if (extension == "md") return ContentType::TEXT_MARKDOWN;
+  if (extension == "jpg" || extension == "jpeg") return ContentType::IMAGE_JPEG;
+  if (extension == "png") return ContentType::IMAGE_PNG;
+  if (extension == "gif") return ContentType::IMAGE_GIF;
+  if (extension == "webp") return ContentType::IMAGE_WEBP;
+  if (extension == "svg") return ContentType::IMAGE_SVG;
+  if (extension == "tiff" || extension == "tif") return ContentType::IMAGE_TIFF;
+  if (extension == "bmp") return ContentType::IMAGE_BMP;
+  if (extension == "mp3") return ContentType::AUDIO_MPEG;
+  if (extension == "wav") return ContentType::AUDIO_WAV;
+  if (extension == "flac") return ContentType::AUDIO_FLAC;
+  if (extension == "ogg") return ContentType::AUDIO_OGG;
+  if (extension == "webm") return ContentType::AUDIO_WEBM;
+  if (extension == "m4a") return ContentType::AUDIO_MP4;
+  if (extension == "mp4") return ContentType::VIDEO_MP4;
+  if (extension == "avi") return ContentType::VIDEO_AVI;
+  if (extension == "mov") return ContentType::VIDEO_QUICKTIME;
+  if (extension == "mkv") return ContentType::VIDEO_MKV;
+  if (extension == "woff") return ContentType::FONT_WOFF;
+  if (extension == "woff2") return ContentType::FONT_WOFF2;
+  if (extension == "ttf") return ContentType::FONT_TTF;
+  if (extension == "otf") return ContentType::FONT_OTF;
+  if (extension == "eot") return ContentType::FONT_EOT;
+  if (extension == "zip") return ContentType::APPLICATION_ZIP;
+  if (extension == "rar") return ContentType::APPLICATION_RAR;
+  if (extension == "gz" || extension == "gzip")
+    return ContentType::APPLICATION_GZIP;
+  if (extension == "tar") return ContentType::APPLICATION_TAR;
+  if (extension == "7z") return ContentType::APPLICATION_7Z;
+  if (extension == "doc") return ContentType::APPLICATION_WORD;
+  if (extension == "docx") return ContentType::APPLICATION_WORD_XML;
+  if (extension == "xls") return ContentType::APPLICATION_EXCEL;
+  if (extension == "xlsx") return ContentType::APPLICATION_EXCEL_XML;
+  if (extension == "ppt") return ContentType::APPLICATION_POWERPOINT;
+  if (extension == "pptx") return ContentType::APPLICATION_POWERPOINT_XML;
+  if (extension == "xhtml") return ContentType::APPLICATION_XHTML;
+  if (extension == "wasm") return ContentType::APPLICATION_WASM;
+
+  return ContentType::APPLICATION_OCTET_STREAM;
+}
+
+std::string contentTypeToString(httpxx::ContentType type) {
+  return std::string(httpxx::contentTypeToString(type));
+}
+
+}  // namespace legacy
+
+int main() {
+  namespace bench = httpxx::bench;
+
+  const std::array<std::string, 6> files{
+      "/var/www/index.html",        "/var/www/css/style.css",
+      "/var/www/js/app.bundle.js",  "/var/www/img/logo.svg",
+      "/var/www/fonts/inter.woff2", "/var/www/download/archive.unknown"};
+  const std::array<std::string, 4> methods{"GET", "POST", "DELETE", "OPTIONS"};
+  const std::array<std::string, 3> mimes{"application/json", "text/html",
+                                         "image/svg+xml"};
+  const auto type_count = httpxx::content_type_names.size();
+
+  std::size_t i = 0;
+  bench::run("legacy getContentTypeFromFilename", [&] {
+    bench::doNotOptimize(
+        legacy::getContentTypeFromFilename(files[i++ % files.size()]));
+  });
+  bench::run("getContentTypeFromFilename", [&] {
+    bench::doNotOptimize(
+        httpxx::getContentTypeFromFilename(files[i++ % files.size()]));
+  });
+  bench::run("mimeTypeFromFilename", [&] {
+    bench::doNotOptimize(
+        httpxx::mimeTypeFromFilename(files[i++ % files.size()]));
+  });
+
+  bench::run("legacy stringToHttpMethod", [&] {
+    bench::doNotOptimize(
+        legacy::stringToHttpMethod(methods[i++ % methods.size()]));
+  });
+  bench::run("stringToHttpMethod", [&] {
+    bench::doNotOptimize(
+        httpxx::stringToHttpMethod(methods[i++ % methods.size()]));
+  });
+
+  bench::run("legacy contentTypeToString", [&] {
+    bench::doNotOptimize(legacy::contentTypeToString(
+        static_cast<httpxx::ContentType>(i++ % type_count)));
+  });
+  bench::run("contentTypeToString", [&] {
+    bench::doNotOptimize(httpxx::contentTypeToString(
+        static_cast<httpxx::ContentType>(i++ % type_count)));
+  });
+
+  bench::run("stringToContentType", [&] {
+    bench::doNotOptimize(
+        httpxx::stringToContentType(mimes[i++ % mimes.size()]));
+  });
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <httpxx/request_handlers.hh>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "harness.hh"
+
+namespace {
+
+// Reads back what was written so the pipe never fills up.
+void drain(int fd, std::vector<char>& scratch, std::size_t size) {
+  while (size > 0) {
+    const auto n = ::read(fd, scratch.data(), std::min(size, scratch.size()));
+    if (n <= 0) {
+      throw std::runtime_error("read from pipe failed");
+    }
+    size -= static_cast<std::size_t>(n);
+  }
+}
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+  using httpxx::FileServer;
+
+  const auto root = std::filesystem::temp_directory_path() /
+                    fmt::format("httpxx-bench-{}", ::getpid());
+  std::filesystem::create_directories(root);
+  const auto small = root / "index.html";
+  const auto large = root / "app.js";
+  std::ofstream(small) << std::string(1024, 'h');
+  std::ofstream(large) << std::string(48 * 1024, 'j');
+
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) == -1) {
+    return 1;
+  }
+  std::vector<char> scratch(64 * 1024);
+
+  // The first call opens the file; after that it comes from the FdCache.
+  bench::run("serveFile 1 KiB (cached fd)", [&] {
+    bench::doNotOptimize(FileServer::serveFile(small));
+  });
+
+  bench::run("serveFile missing", [&] {
+    bench::doNotOptimize(FileServer::serveFile(root / "missing.html"));
+  });
+
+  for (const auto& path : {small, large}) {
+    const auto wire_size =
+        FileServer::serveFile(path).headString().size() +
+        std::filesystem::file_size(path);
+    bench::run(fmt::format("serveFile + sendfile to pipe, {} B",
+                           std::filesystem::file_size(path)),
+               [&] {
+                 httpxx::ResponseWriter::write(FileServer::serveFile(path),
+                                               fds[1]);
+                 drain(fds[0], scratch, wire_size);
+               });
+  }
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace httpxx::bench {
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Prints one result, and with HTTPXX_BENCH_JSON set appends it as a line of
+// JSON to the file named there. Every result is a single write to a file
+// opened for appending, so the suites can share one file; see README.
+inline void report(std::string_view name, double ns, std::size_t iterations) {
+  fmt::print("{:<40} {:>10.2f} ns/op {:>12} iterations\n", name, ns,
+             iterations);
+
+  const char* path = std::getenv("HTTPXX_BENCH_JSON");
+  if (path == nullptr || *path == '\0') {
+    return;
+  }
+  std::string_view suite = program_invocation_short_name;
+  if (suite.starts_with("bench_")) {
+    suite.remove_prefix(6);
+  }
+  const auto line = fmt::format(
+      "{{\"suite\":\"{}\",\"name\":\"{}\",\"ns_per_op\":{:.3f},"
+      "\"iterations\":{}}}\n",
+      suite, name, ns, iterations);
+  const int fd = ::open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1 || ::write(fd, line.data(), line.size()) !=
+                      static_cast<ssize_t>(line.size())) {
+    fmt::print(stderr, "cannot write {}\n", path);
+  }
+  if (fd != -1) {
+    ::close(fd);
+  }
+}
+
+// Runs fn in batches until at least min_time has elapsed and reports the mean
+// cost of a single call.
+template <typename Fn>
+double run(std::string_view name, Fn&& fn,
+           std::chrono::milliseconds min_time = std::chrono::milliseconds{
+               200}) {
+  using clock = std::chrono::steady_clock;
+
+  std::size_t iterations = 0;
+  std::size_t batch = 64;
+  const auto start = clock::now();
+  auto elapsed = clock::duration::zero();
+
+  while (elapsed < min_time) {
+    for (std::size_t i = 0; i < batch; ++i) {
+      fn();
+    }
+    iterations += batch;
+    batch *= 2;
+    elapsed = clock::now() - start;
+  }
+
+  const double ns =
+      std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  report(name, ns, iterations);
+  return ns;
+}
+
+}  // namespace httpxx::bench
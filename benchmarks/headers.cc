@@ -0,0 +1,49 @@
+#include <array>
+#include <httpxx/headers.hh>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "harness.hh"
+
+namespace {
+
+constexpr std::array<std::pair<std::string_view, std::string_view>, 9>
+    request_headers{{
+        {"Host", "localhost:8080"},
+        {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64; rv:131.0)"},
+        {"Accept", "text/html,application/xhtml+xml"},
+        {"Accept-Language", "en-US,en;q=0.5"},
+        {"Accept-Encoding", "gzip, deflate, br"},
+        {"Connection", "keep-alive"},
+        {"Cookie", "session=8f2c1a"},
+        {"Upgrade-Insecure-Requests", "1"},
+        {"Cache-Control", "max-age=0"},
+    }};
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+
+  bench::run("unordered_map build + 2 lookups", [] {
+    std::unordered_map<std::string, std::string> headers;
+    for (const auto& [name, value] : request_headers) {
+      headers[std::string(name)] = std::string(value);
+    }
+    bench::doNotOptimize(headers.find("Host"));
+    bench::doNotOptimize(headers.find("Connection"));
+  });
+
+  bench::run("Headers build + 2 lookups", [] {
+    httpxx::Headers headers;
+    for (const auto& [name, value] : request_headers) {
+      headers.add(name, value);
+    }
+    bench::doNotOptimize(headers.get(httpxx::HeaderId::HOST));
+    bench::doNotOptimize(headers.get("connection"));
+  });
+
+  return 0;
+}
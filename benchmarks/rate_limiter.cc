@@ -0,0 +1,87 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <httpxx/rate_limiter.hh>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "harness.hh"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t client_count = 4'000'000;
+constexpr std::size_t thread_count = 4;
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+  using httpxx::RateLimit;
+  using httpxx::RateLimiter;
+
+  const RateLimit limit{10, 20};
+  auto start = RateLimiter::clock::now();
+  auto limiter = std::make_unique<RateLimiter>(start);
+
+  // Four million distinct clients, each seen once.
+  for (uint64_t key = 1; key <= client_count; ++key) {
+    limiter->acquire(key, limit, start);
+  }
+  fmt::print("{} buckets\n", limiter->size());
+
+  std::mt19937_64 rng(42);
+  auto now = start;
+  bench::run("acquire, known key (4M keys)", [&] {
+    now += 1us;
+    bench::doNotOptimize(
+        limiter->acquire(rng() % client_count + 1, limit, now));
+  });
+
+  uint64_t fresh = client_count;
+  bench::run("acquire, new key", [&] {
+    now += 1us;
+    bench::doNotOptimize(limiter->acquire(++fresh, limit, now));
+  });
+
+  // Every bucket is full again after burst / rate seconds.
+  const auto later = now + 3s;
+  std::size_t evicted = 0;
+  const auto sweep_start = RateLimiter::clock::now();
+  for (std::size_t i = 0; i < RateLimiter::shard_count; ++i) {
+    evicted += limiter->evictIdle(later);
+  }
+  const auto sweep =
+      std::chrono::duration<double, std::milli>(RateLimiter::clock::now() -
+                                                sweep_start);
+  fmt::print("evicted {} idle buckets in {:.1f} ms, {} left\n", evicted,
+             sweep.count(), limiter->size());
+
+  // Workers hammering the shared limiter with random clients.
+  std::atomic<uint64_t> total{0};
+  const auto contended_start = RateLimiter::clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t] {
+        std::mt19937_64 local(t);
+        constexpr std::size_t per_thread = 2'000'000;
+        for (std::size_t i = 0; i < per_thread; ++i) {
+          bench::doNotOptimize(limiter->acquire(
+              local() % client_count + 1, limit, RateLimiter::clock::now()));
+        }
+        total += per_thread;
+      });
+    }
+  }
+  const auto contended = std::chrono::duration<double, std::nano>(
+      RateLimiter::clock::now() - contended_start);
+  bench::report(fmt::format("acquire, {} threads", thread_count),
+                contended.count() / static_cast<double>(total), total.load());
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <httpxx/request_handlers.hh>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "harness.hh"
+
+namespace {
+
+httpxx::Response makeResponse(std::size_t body_size) {
+  return httpxx::ResponseBuilder::ok()
+      .contentType("application/json")
+      .header("Cache-Control", "no-store")
+      .header(httpxx::HeaderId::ETAG, "\"5f2b-1a2c\"")
+      .body(std::string(body_size, 'x'))
+      .build();
+}
+
+// Reads back what was written so the pipe never fills up.
+void drain(int fd, std::vector<char>& scratch, std::size_t size) {
+  while (size > 0) {
+    const auto n = ::read(fd, scratch.data(), std::min(size, scratch.size()));
+    if (n <= 0) {
+      throw std::runtime_error("read from pipe failed");
+    }
+    size -= static_cast<std::size_t>(n);
+  }
+}
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+
+  int fds[2];
+  if (::pipe2(fds, O_CLOEXEC) == -1) {
+    return 1;
+  }
+  std::vector<char> scratch(64 * 1024);
+
+  for (const std::size_t body_size : {64, 2048, 32 * 1024}) {
+    const auto response = makeResponse(body_size);
+    const auto wire_size = response.toString().size();
+
+    bench::run(fmt::format("Response::toString, {} B body", body_size),
+               [&] { bench::doNotOptimize(response.toString()); });
+
+    // Includes the copy of the response that write() takes ownership of.
+    bench::run(fmt::format("ResponseWriter to pipe, {} B body", body_size),
+               [&] {
+                 httpxx::ResponseWriter::write(response, fds[1]);
+                 drain(fds[0], scratch, wire_size);
+               });
+  }
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <array>
+#include <httpxx/router.hh>
+#include <string>
+#include <vector>
+
+#include "harness.hh"
+
+namespace {
+
+// Routes shaped like a REST API: /api/v1/<resource>/<n>, every one taking
+// GET and POST.
+httpxx::Router makeRouter(std::size_t routes,
+                          std::vector<std::string>& paths) {
+  constexpr std::array resources{"users", "tasks", "projects", "comments",
+                                 "files"};
+  httpxx::RouterBuilder builder;
+  paths.clear();
+  for (std::size_t i = 0; i < routes; ++i) {
+    paths.push_back(
+        fmt::format("/api/v1/{}/{}", resources[i % resources.size()], i));
+    builder.add(paths.back(), {httpxx::HttpMethod::GET,
+                               httpxx::HttpMethod::POST},
+                [](const httpxx::Request&) {
+                  return httpxx::ResponseBuilder::ok().build();
+                });
+  }
+  return builder.build();
+}
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+  using httpxx::HttpMethod;
+
+  std::vector<std::string> paths;
+  for (const std::size_t routes : {10, 100, 1000}) {
+    const auto router = makeRouter(routes, paths);
+
+    // Every lookup in turn, so the average covers early and late routes.
+    std::size_t next = 0;
+    bench::run(fmt::format("get_endpoint GET, {} routes", routes), [&] {
+      bench::doNotOptimize(router.get_endpoint(paths[next], HttpMethod::GET));
+      next = next + 1 == paths.size() ? 0 : next + 1;
+    });
+
+    bench::run(fmt::format("get_endpoint miss, {} routes", routes), [&] {
+      bench::doNotOptimize(
+          router.get_endpoint("/api/v1/unknown", HttpMethod::GET));
+    });
+  }
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include <chrono>
+#include <cstddef>
+#include <httpxx/timer_wheel.hh>
+#include <memory>
+#include <random>
+
+#include "harness.hh"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t armed_timers = 1'000'000;
+
+}  // namespace
+
+int main() {
+  namespace bench = httpxx::bench;
+  using httpxx::TimerNode;
+  using httpxx::TimerWheel;
+
+  // A million idle connections with keep-alive timeouts spread over a minute.
+  auto start = TimerWheel::clock::now();
+  auto wheel = std::make_unique<TimerWheel>(start);
+  auto nodes = std::make_unique<TimerNode[]>(armed_timers);
+  std::mt19937 rng(42);
+  for (std::size_t i = 0; i < armed_timers; ++i) {
+    wheel->schedule(nodes[i], std::chrono::milliseconds(rng() % 60'000));
+  }
+
+  std::size_t next = 0;
+  bench::run("re-arm (1M armed)", [&] {
+    wheel->schedule(nodes[next], 5s);
+    next = (next + 1) % armed_timers;
+  });
+
+  bench::run("cancel + schedule (1M armed)", [&] {
+    wheel->cancel(nodes[next]);
+    wheel->schedule(nodes[next], 30s);
+    next = (next + 1) % armed_timers;
+  });
+
+  // Every expired timer is re-armed, as a connection answering another
+  // request would, so the wheel stays at a million timers.
+  std::size_t fired = 0;
+  auto now = start;
+  bench::run("advance 10ms (1M armed)", [&] {
+    now += TimerWheel::tick;
+    wheel->advance(now, [&](TimerNode& node) {
+      ++fired;
+      wheel->schedule(node, std::chrono::milliseconds(rng() % 60'000));
+    });
+  });
+  fmt::print("fired {} timers, {} still armed\n", fired, wheel->size());
+
+  return 0;
+}
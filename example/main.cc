@@ -106,7 +106,7 @@
 //                     nlohmann::json data;
 //                     for (const auto& [key, value] :
 //                          request.request_parameters) {
-//                       data[key] = value;
+//                       data[std::string(key)] = value;
 //                     }
 //
 //                     // Add the full parameters map (as a JSON object) for
@@ -228,7 +228,7 @@ class TaskManager {
     return result;
   }
 
-  bool update_task(const std::string& id, const nlohmann::json& update_data) {
+  bool update_task(std::string_view id, const nlohmann::json& update_data) {
     std::lock_guard<std::mutex> lock(mutex_);
     auto it = std::find_if(tasks_.begin(), tasks_.end(),
                            [&id](const Task& task) { return task.id == id; });
@@ -245,7 +245,7 @@ class TaskManager {
     return true;
   }
 
-  bool delete_task(const std::string& id) {
+  bool delete_task(std::string_view id) {
     std::lock_guard<std::mutex> lock(mutex_);
     auto it = std::find_if(tasks_.begin(), tasks_.end(),
                            [&id](const Task& task) { return task.id == id; });
@@ -0,0 +1,37 @@
+#include <cstddef>
+#include <cstdint>
+#include <httpxx/request_handlers.hh>
+#include <optional>
+#include <string_view>
+
+// Request framing: how the event loop decides where one pipelined request
+// ends and the next begins. Content-Length is the only body framing; any
+// Transfer-Encoding, like other ambiguous framing, is rejected with
+// ParseError. A length must never exceed the bytes received, and must not
+// change when more bytes arrive behind the request.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  using httpxx::RequestParser;
+  const std::string_view input(reinterpret_cast<const char*>(data), size);
+
+  const auto head = RequestParser::headLength(input);
+  std::optional<std::size_t> message;
+  try {
+    message = RequestParser::messageLength(input);
+  } catch (const httpxx::ParseError&) {
+    return 0;
+  }
+  if (head && *head > size) {
+    __builtin_trap();
+  }
+  if (message && (!head || *message < *head || *message > size)) {
+    __builtin_trap();
+  }
+
+  if (message) {
+    const auto prefix = input.substr(0, *message);
+    if (RequestParser::messageLength(prefix) != message) {
+      __builtin_trap();
+    }
+  }
+  return 0;
+}
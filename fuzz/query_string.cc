@@ -0,0 +1,38 @@
+#include <cstddef>
+#include <cstdint>
+#include <httpxx/request_handlers.hh>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// The query string of the request target, as parsed into
+// Request::request_parameters. The input becomes the part after '?' in an
+// otherwise valid request line; bytes that would end the line are dropped.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  std::string query;
+  query.reserve(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    const char c = static_cast<char>(data[i]);
+    if (c != ' ' && c != '\r' && c != '\n') {
+      query.push_back(c);
+    }
+  }
+  const auto request_line = "GET /search?" + query + " HTTP/1.1\r\n\r\n";
+
+  try {
+    const auto request = httpxx::RequestParser::parse(request_line);
+    if (request.uri != "/search") {
+      __builtin_trap();
+    }
+    for (const auto& [name, value] : request.request_parameters) {
+      const std::string_view key = name;
+      if (key.find_first_of("&=") != key.npos ||
+          value.find_first_of("&=") != std::string_view::npos) {
+        __builtin_trap();
+      }
+    }
+  } catch (const std::runtime_error&) {
+    __builtin_trap();
+  }
+  return 0;
+}
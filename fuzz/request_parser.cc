@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <cstdint>
+#include <httpxx/arena.hh>
+#include <httpxx/request_handlers.hh>
+#include <string_view>
+
+// Whole requests through RequestParser::parse() and the helpers the event
+// loop runs on raw input before it. Malformed input may only be rejected
+// with ParseError, which respond() answers with 400 Bad Request; anything
+// else escaping, or a crash, is a bug.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  using httpxx::RequestParser;
+  const std::string_view input(reinterpret_cast<const char*>(data), size);
+
+  [[maybe_unused]] const auto target = RequestParser::target(input);
+  [[maybe_unused]] const auto forwarded =
+      RequestParser::header(input, "X-Forwarded-For");
+
+  static httpxx::RequestArena arena;
+  try {
+    const auto request = RequestParser::parse(input, arena.resource());
+    if (request.body && request.body->size() > size) {
+      __builtin_trap();
+    }
+    for (const auto& [name, value] : request.headers) {
+      if (name.empty() || name.size() + value.size() > size) {
+        __builtin_trap();
+      }
+    }
+  } catch (const httpxx::ParseError&) {
+  }
+  arena.reset();
+
+  const auto line_end = input.find('\n');
+  const auto line = input.substr(0, line_end);
+  try {
+    httpxx::HttpUtils::extractHttpVersion(line.substr(line.rfind(' ') + 1));
+  } catch (const httpxx::ParseError&) {
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <cstddef>
+#include <cstdint>
+#include <httpxx/request_handlers.hh>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Pipelined requests answered in turn on one kept-alive connection, then
+// read back the way a client frames responses. Every response that may have
+// a body must say where it ends, including those whose handler set none;
+// one that cannot be framed would swallow the responses behind it.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  using httpxx::RequestParser;
+  std::string_view input(reinterpret_cast<const char*>(data), size);
+
+  static const auto router = [] {
+    httpxx::Router router;
+    router.add_endpoint("/empty", {httpxx::HttpMethod::GET},
+                        [](const httpxx::Request&) {
+                          return httpxx::ResponseBuilder::ok().build();
+                        });
+    router.add_endpoint("/created", {httpxx::HttpMethod::POST},
+                        [](const httpxx::Request&) {
+                          return httpxx::ResponseBuilder::created().build();
+                        });
+    router.add_endpoint("/text", {httpxx::HttpMethod::GET},
+                        [](const httpxx::Request&) {
+                          return httpxx::ResponseBuilder::ok()
+                              .text("hello")
+                              .build();
+                        });
+    return router;
+  }();
+  // Files would be served from below a path that is not a directory, so no
+  // request reaches the file system.
+  static const auto config = httpxx::Config().setWwwPath("/dev/null");
+
+  std::string wire;
+  std::size_t answered = 0;
+  while (!input.empty()) {
+    std::optional<std::size_t> length;
+    try {
+      length = RequestParser::messageLength(input);
+    } catch (const httpxx::ParseError&) {
+      break;
+    }
+    if (!length) {
+      break;
+    }
+    const auto response = httpxx::RequestHandler::respond(
+        router, config, input.substr(0, *length));
+    wire += response.toString();
+    ++answered;
+    input.remove_prefix(*length);
+    if (response.headers.get(httpxx::HeaderId::CONNECTION) == "close") {
+      break;
+    }
+  }
+
+  std::string_view rest = wire;
+  for (std::size_t i = 0; i < answered; ++i) {
+    const auto head = RequestParser::headLength(rest);
+    if (!head || rest.size() < 12) {
+      __builtin_trap();
+    }
+    const auto status = rest.substr(9, 3);
+    std::size_t body = 0;
+    if (status[0] != '1' && status != "204" && status != "304") {
+      const auto length = RequestParser::header(rest, "Content-Length");
+      if (!length) {
+        __builtin_trap();
+      }
+      const auto [end, ec] = std::from_chars(
+          length->data(), length->data() + length->size(), body);
+      if (ec != std::errc{} || end != length->data() + length->size()) {
+        __builtin_trap();
+      }
+    }
+    if (*head + body > rest.size()) {
+      __builtin_trap();
+    }
+    rest.remove_prefix(*head + body);
+  }
+  if (!rest.empty()) {
+    __builtin_trap();
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <httpxx/request_handlers.hh>
+#include <httpxx/tracing.hh>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+
+// Sampled requests through the trace exporter, the way the event loop hands
+// them over: a span is named after the parsed method, and a request that did
+// not parse is not exported. Whatever the client sent, the export must be
+// one line of valid JSON per batch.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+  using httpxx::RequestParser;
+  const std::string_view input(reinterpret_cast<const char*>(data), size);
+
+  static const auto router = [] {
+    httpxx::Router router;
+    router.add_endpoint("/", {httpxx::HttpMethod::GET},
+                        [](const httpxx::Request&) {
+                          return httpxx::ResponseBuilder::ok().build();
+                        });
+    router.add_endpoint(R"(/"quoted"\route)", {httpxx::HttpMethod::POST},
+                        [](const httpxx::Request&) {
+                          return httpxx::ResponseBuilder::ok().build();
+                        });
+    return router;
+  }();
+  static const httpxx::Config config;
+  static const auto path =
+      std::string("/tmp/httpxx-fuzz-trace-") + std::to_string(::getpid());
+
+  httpxx::TraceSampler sampler(1.0);
+  auto trace = sampler.decide(RequestParser::header(input, "traceparent"));
+  if (!trace) {
+    return 0;
+  }
+  httpxx::RequestTiming timing;
+  const auto response = httpxx::RequestHandler::respond(
+      router, config, input, std::pmr::get_default_resource(), &timing);
+  if (!timing.method) {
+    return 0;
+  }
+  trace->method = *timing.method;
+
+  ::unlink(path.c_str());
+  {
+    httpxx::Tracer tracer(path);
+    tracer.setRoutes(router);
+    tracer.attach().tryPush([&](httpxx::TraceRecord& record) {
+      record.trace = *trace;
+      record.span_ids = {};
+      record.times = {};
+      record.route = timing.route;
+      record.status = static_cast<uint16_t>(response.status_code);
+    });
+  }
+
+  std::ifstream exported(path);
+  std::string line;
+  std::size_t lines = 0;
+  while (std::getline(exported, line)) {
+    ++lines;
+    if (nlohmann::json::parse(line, nullptr, false).is_discarded()) {
+      __builtin_trap();
+    }
+  }
+  if (lines != 1) {
+    __builtin_trap();
+  }
+  ::unlink(path.c_str());
+  return 0;
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "httpxx/background_thread.hh"
+#include "httpxx/client_address.hh"
+#include "httpxx/json_escape.hh"
+#include "httpxx/spsc_ring.hh"
+
+namespace httpxx {
+
+enum class AccessLogFormat : uint8_t { COMMON, COMBINED, JSON };
+
+inline AccessLogFormat accessLogFormatFromString(std::string_view name) {
+  if (name == "common") return AccessLogFormat::COMMON;
+  if (name == "combined") return AccessLogFormat::COMBINED;
+  if (name == "json") return AccessLogFormat::JSON;
+  throw std::invalid_argument(
+      fmt::format("[httpx::AccessLog] Unknown format '{}'", name));
+}
+
+// One access log entry as workers hand it to the logger: fixed size and
+// trivially copyable, with text fields truncated to fit. Formatting into
+// text happens on the logger thread.
+struct AccessRecord {
+  template <std::size_t N>
+  struct Text {
+    std::array<char, N> data;
+    uint16_t length;
+
+    void assign(std::string_view text) {
+      length = static_cast<uint16_t>(std::min(text.size(), N));
+      std::memcpy(data.data(), text.data(), length);
+    }
+
+    [[nodiscard]] std::string_view view() const {
+      return {data.data(), length};
+    }
+  };
+
+  int64_t time_ns;
+  int64_t duration_ns;
+  uint64_t bytes;
+  ClientAddress client;
+  uint16_t status;
+  Text<256> request_line;
+  Text<128> referer;
+  Text<128> user_agent;
+};
+
+// Access log written by a background thread. Every worker gets a ring of its
+// own from attach() and pushes records into it without blocking; when the
+// ring is full the record is dropped and the worker counts it. The logger
+// thread wakes every flush_interval, formats whatever the rings hold and
+// writes it out in large chunks. With max_bytes set the file is rotated to
+// path.1 ... path.keep once it grows past that size.
+class AccessLog {
+ public:
+  static constexpr std::size_t ring_capacity = 2048;
+  static constexpr std::size_t write_chunk = 64 * 1024;
+  static constexpr std::chrono::milliseconds flush_interval{50};
+
+  using Ring = SpscRing<AccessRecord, ring_capacity>;
+
+  AccessLog(std::filesystem::path path, AccessLogFormat format,
+            uint64_t max_bytes = 0, std::size_t keep = 5)
+      : path_(std::move(path)),
+        format_(format),
+        max_bytes_(max_bytes),
+        keep_(keep) {
+    open();
+    thread_ = startBackgroundThread(
+        [this](std::stop_token stop) { run(stop); });
+  }
+
+  AccessLog(const AccessLog&) = delete;
+  AccessLog& operator=(const AccessLog&) = delete;
+
+  ~AccessLog() {
+    thread_.request_stop();
+    thread_.join();
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  [[nodiscard]] AccessLogFormat format() const { return format_; }
+
+  // Rings are never detached, so records of a worker that has stopped are
+  // still written.
+  [[nodiscard]] Ring& attach() {
+    std::lock_guard lock(mutex_);
+    rings_.push_back(std::make_unique<Ring>());
+    return *rings_.back();
+  }
+
+ private:
+  std::filesystem::path path_;
+  AccessLogFormat format_;
+  uint64_t max_bytes_;
+  std::size_t keep_;
+  int fd_{-1};
+  uint64_t file_size_{0};
+  fmt::memory_buffer out_;
+  int64_t stamped_second_{-1};
+  std::string stamp_;
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::jthread thread_;
+
+  void run(std::stop_token stop) {
+    std::vector<Ring*> rings;
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait_for(lock, stop, flush_interval, [] { return false; });
+        rings.clear();
+        for (const auto& ring : rings_) {
+          rings.push_back(ring.get());
+        }
+      }
+      for (auto* ring : rings) {
+        ring->drain([this](const AccessRecord& record) {
+          append(record);
+          if (out_.size() >= write_chunk) {
+            flush();
+          }
+        });
+      }
+      flush();
+      if (stop.stop_requested()) {
+        return;
+      }
+    }
+  }
+
+  void open() {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+                 0644);
+    if (fd_ == -1) {
+      throw std::runtime_error(
+          fmt::format("[httpx::AccessLog] Cannot open {}: {}", path_.string(),
+                      std::strerror(errno)));
+    }
+    struct stat info {};
+    file_size_ =
+        ::fstat(fd_, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+  }
+
+  void flush() {
+    if (fd_ == -1) {
+      out_.clear();
+      return;
+    }
+    std::string_view pending(out_.data(), out_.size());
+    while (!pending.empty()) {
+      const auto written = ::write(fd_, pending.data(), pending.size());
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        std::clog << fmt::format("[httpx::AccessLog] write: {}\n",
+                                 std::strerror(errno));
+        break;
+      }
+      pending.remove_prefix(static_cast<std::size_t>(written));
+      file_size_ += static_cast<uint64_t>(written);
+    }
+    out_.clear();
+
+    if (max_bytes_ != 0 && file_size_ >= max_bytes_) {
+      rotate();
+    }
+  }
+
+  void rotate() {
+    ::close(fd_);
+    const auto numbered = [this](std::size_t n) {
+      return std::filesystem::path(path_.string() + "." + std::to_string(n));
+    };
+    std::error_code ignored;
+    if (keep_ == 0) {
+      std::filesystem::remove(path_, ignored);
+    } else {
+      for (std::size_t n = keep_; n > 1; --n) {
+        std::filesystem::rename(numbered(n - 1), numbered(n), ignored);
+      }
+      std::filesystem::rename(path_, numbered(1), ignored);
+    }
+    try {
+      open();
+    } catch (const std::exception& e) {
+      std::clog << e.what() << '\n';
+    }
+  }
+
+  void append(const AccessRecord& record) {
+    auto it = std::back_inserter(out_);
+    const auto client = record.client.toString();
+    const auto duration_us = record.duration_ns / 1000;
+
+    if (format_ == AccessLogFormat::JSON) {
+      std::string_view method = record.request_line.view();
+      std::string_view uri;
+      std::string_view protocol;
+      if (const auto space = method.find(' '); space != method.npos) {
+        uri = method.substr(space + 1);
+        method = method.substr(0, space);
+        if (const auto last = uri.rfind(' '); last != uri.npos) {
+          protocol = uri.substr(last + 1);
+          uri = uri.substr(0, last);
+        }
+      }
+
+      fmt::format_to(it, R"({{"time":"{}","client":"{}","method":")",
+                     timestamp(record.time_ns), client);
+      appendJsonEscaped(out_, method);
+      fmt::format_to(it, R"(","uri":")");
+      appendJsonEscaped(out_, uri);
+      fmt::format_to(it, R"(","protocol":")");
+      appendJsonEscaped(out_, protocol);
+      fmt::format_to(it,
+                     R"(","status":{},"bytes":{},"duration_us":{},"referer":")",
+                     record.status, record.bytes, duration_us);
+      appendJsonEscaped(out_, record.referer.view());
+      fmt::format_to(it, R"(","user_agent":")");
+      appendJsonEscaped(out_, record.user_agent.view());
+      fmt::format_to(it, "\"}}\n");
+      return;
+    }
+
+    // Escaped as in JSON too, so a client cannot forge log lines.
+    fmt::format_to(it, "{} - - [{}] \"", client, timestamp(record.time_ns));
+    appendJsonEscaped(out_, record.request_line.view());
+    fmt::format_to(it, "\" {} ", record.status);
+    if (record.bytes == 0) {
+      out_.push_back('-');
+    } else {
+      fmt::format_to(it, "{}", record.bytes);
+    }
+    if (format_ == AccessLogFormat::COMBINED) {
+      for (const auto header : {record.referer.view(),
+                                record.user_agent.view()}) {
+        out_.append(std::string_view(" \""));
+        if (header.empty()) {
+          out_.push_back('-');
+        } else {
+          appendJsonEscaped(out_, header);
+        }
+        out_.push_back('"');
+      }
+    }
+    out_.push_back('\n');
+  }
+
+  // Formatted at most once per second.
+  const std::string& timestamp(int64_t time_ns) {
+    const auto second = time_ns / 1'000'000'000;
+    if (second != stamped_second_) {
+      stamped_second_ = second;
+      const auto time = fmt::gmtime(static_cast<std::time_t>(second));
+      stamp_ = format_ == AccessLogFormat::JSON
+                   ? fmt::format("{:%Y-%m-%dT%H:%M:%SZ}", time)
+                   : fmt::format("{:%d/%b/%Y:%H:%M:%S} +0000", time);
+    }
+    return stamp_;
+  }
+};
+
+}  // namespace httpxx
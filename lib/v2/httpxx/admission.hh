@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace httpxx {
+
+// CoDel-style admission control for one worker. The sojourn time of a request
+// is how long it has been ready but not yet served. A burst that pushes
+// sojourn times above target is absorbed; once they stay above it for a whole
+// interval there is a standing queue and every request over target is shed
+// until one gets through in time again. Packet CoDel drops at a slowly rising
+// rate to make TCP senders back off; HTTP clients do not slow down on a 503,
+// so the queue is cut back directly.
+class AdmissionControl {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  AdmissionControl(clock::duration target, clock::duration interval)
+      : target_(target), interval_(interval) {}
+
+  // Returns false when the request should be shed. A target of zero admits
+  // everything.
+  bool admit(clock::duration sojourn, clock::time_point now) {
+    if (target_ <= clock::duration::zero() || sojourn < target_) {
+      above_since_ = clock::time_point{};
+      return true;
+    }
+
+    if (above_since_ == clock::time_point{}) {
+      above_since_ = now;
+      return true;
+    }
+    if (now - above_since_ < interval_) {
+      return true;
+    }
+
+    ++shed_;
+    return false;
+  }
+
+  [[nodiscard]] uint64_t shedCount() const { return shed_; }
+
+ private:
+  clock::duration target_;
+  clock::duration interval_;
+  clock::time_point above_since_{};
+  uint64_t shed_{0};
+};
+
+}  // namespace httpxx
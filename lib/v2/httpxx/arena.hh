@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace httpxx {
+
+// Monotonic arena for everything allocated while one request is in flight:
+// the parsed Request, its headers and parameters and parser scratch. reset()
+// drops it all at once after the handler returned and rewinds to the initial
+// block, so steady-state requests allocate nothing from the global heap for
+// those objects.
+class RequestArena {
+ public:
+  static constexpr std::size_t default_initial_size = 16 * 1024;
+
+  explicit RequestArena(std::size_t initial_size = default_initial_size)
+      : buffer_(std::make_unique<std::byte[]>(initial_size)),
+        resource_(buffer_.get(), initial_size,
+                  std::pmr::new_delete_resource()) {}
+
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  [[nodiscard]] std::pmr::memory_resource* resource() { return &resource_; }
+
+  void reset() { resource_.release(); }
+
+ private:
+  std::unique_ptr<std::byte[]> buffer_;
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+}  // namespace httpxx
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "httpxx/enums.hh"
+
+namespace httpxx {
+
+// On-disk layout, all integers in host byte order:
+//
+//   AssetPackHeader
+//   AssetPackEntry[entry_count]   sorted by path
+//   string table                  paths and ETags
+//   padding to page size
+//   blobs                         each body and gzip variant page-aligned
+struct AssetPackHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t entry_count;
+  uint64_t entries_offset;
+  uint64_t strings_offset;
+  uint64_t strings_length;
+  uint64_t file_size;
+};
+
+struct AssetPackEntry {
+  uint64_t path_offset;
+  uint32_t path_length;
+  uint32_t content_type;
+  uint64_t etag_offset;
+  uint32_t etag_length;
+  uint32_t reserved;
+  uint64_t body_offset;
+  uint64_t body_length;
+  uint64_t gzip_offset;
+  uint64_t gzip_length;
+};
+
+static_assert(sizeof(AssetPackHeader) == 48);
+static_assert(sizeof(AssetPackEntry) == 64);
+
+inline constexpr char asset_pack_magic[8] = {'H', 'T', 'X', 'X',
+                                             'P', 'A', 'C', 'K'};
+inline constexpr uint32_t asset_pack_version = 1;
+inline constexpr uint64_t asset_pack_alignment = 4096;
+
+class AssetPackError : public std::runtime_error {
+ public:
+  explicit AssetPackError(const std::string& message)
+      : std::runtime_error(message) {}
+};
+
+struct Asset {
+  ContentType content_type{ContentType::APPLICATION_OCTET_STREAM};
+  std::string_view etag{};
+  std::string_view body{};
+  std::string_view gzip{};
+};
+
+class AssetPack {
+ public:
+  static std::shared_ptr<const AssetPack> open(
+      const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      throw AssetPackError(
+          fmt::format("Cannot open asset pack '{}'", path.string()));
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == -1 ||
+        static_cast<std::size_t>(st.st_size) < sizeof(AssetPackHeader)) {
+      ::close(fd);
+      throw AssetPackError(
+          fmt::format("Asset pack '{}' is truncated", path.string()));
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      throw AssetPackError(
+          fmt::format("Cannot map asset pack '{}'", path.string()));
+    }
+
+    std::shared_ptr<const AssetPack> pack(
+        new AssetPack(static_cast<const char*>(data), size));
+    pack->validate(path);
+    return pack;
+  }
+
+  AssetPack(const AssetPack&) = delete;
+  AssetPack& operator=(const AssetPack&) = delete;
+
+  ~AssetPack() { ::munmap(const_cast<char*>(data_), size_); }
+
+  [[nodiscard]] std::optional<Asset> find(std::string_view path) const {
+    const auto* first = entries();
+    const auto* last = first + header().entry_count;
+    const auto* it = std::lower_bound(
+        first, last, path, [this](const AssetPackEntry& entry, auto key) {
+          return pathOf(entry) < key;
+        });
+
+    if (it == last || pathOf(*it) != path) {
+      return std::nullopt;
+    }
+
+    return Asset{static_cast<ContentType>(it->content_type),
+                 slice(it->etag_offset, it->etag_length),
+                 slice(it->body_offset, it->body_length),
+                 slice(it->gzip_offset, it->gzip_length)};
+  }
+
+  [[nodiscard]] std::size_t size() const { return header().entry_count; }
+
+ private:
+  const char* data_;
+  std::size_t size_;
+
+  AssetPack(const char* data, std::size_t size) : data_(data), size_(size) {}
+
+  [[nodiscard]] const AssetPackHeader& header() const {
+    return *reinterpret_cast<const AssetPackHeader*>(data_);
+  }
+
+  [[nodiscard]] const AssetPackEntry* entries() const {
+    return reinterpret_cast<const AssetPackEntry*>(data_ +
+                                                   header().entries_offset);
+  }
+
+  [[nodiscard]] std::string_view slice(uint64_t offset, uint64_t length) const {
+    return {data_ + offset, static_cast<std::size_t>(length)};
+  }
+
+  [[nodiscard]] std::string_view pathOf(const AssetPackEntry& entry) const {
+    return slice(entry.path_offset, entry.path_length);
+  }
+
+  [[nodiscard]] bool inBounds(uint64_t offset, uint64_t length) const {
+    return offset <= size_ && length <= size_ - offset;
+  }
+
+  void validate(const std::filesystem::path& path) const {
+    const auto& h = header();
+    auto fail = [&path](std::string_view reason) {
+      throw AssetPackError(fmt::format("Invalid asset pack '{}': {}",
+                                       path.string(), reason));
+    };
+
+    if (std::memcmp(h.magic, asset_pack_magic, sizeof(h.magic)) != 0) {
+      fail("bad magic");
+    }
+    if (h.version != asset_pack_version) {
+      fail(fmt::format("unsupported version {}", h.version));
+    }
+    if (h.file_size != size_ ||
+        !inBounds(h.entries_offset,
+                  uint64_t{h.entry_count} * sizeof(AssetPackEntry)) ||
+        h.entries_offset % alignof(AssetPackEntry) != 0 ||
+        !inBounds(h.strings_offset, h.strings_length)) {
+      fail("corrupt header");
+    }
+
+    for (uint32_t i = 0; i < h.entry_count; ++i) {
+      const auto& e = entries()[i];
+      if (!inBounds(e.path_offset, e.path_length) ||
+          !inBounds(e.etag_offset, e.etag_length) ||
+          !inBounds(e.body_offset, e.body_length) ||
+          !inBounds(e.gzip_offset, e.gzip_length) ||
+          e.content_type > static_cast<uint32_t>(ContentType::UNKNOWN)) {
+        fail(fmt::format("corrupt entry {}", i));
+      }
+      if (i > 0 && !(pathOf(entries()[i - 1]) < pathOf(e))) {
+        fail("index is not sorted");
+      }
+    }
+  }
+};
+
+class AssetPackWriter {
+ public:
+  void add(std::string path, std::vector<char> body,
+           std::optional<std::vector<char>> gzip = std::nullopt) {
+    files_.push_back({std::move(path), std::move(body), std::move(gzip)});
+  }
+
+  // Packs every regular file below root. A sibling "<name>.gz" is stored as
+  // the precompressed variant of "<name>" instead of as its own asset.
+  static AssetPackWriter fromDirectory(const std::filesystem::path& root) {
+    AssetPackWriter writer;
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(root)) {
+      if (!entry.is_regular_file()) continue;
+
+      const auto& file = entry.path();
+      auto original = file;
+      if (file.extension() == ".gz" &&
+          std::filesystem::exists(original.replace_extension())) {
+        continue;
+      }
+
+      auto gzip_path = file;
+      gzip_path += ".gz";
+      std::optional<std::vector<char>> gzip;
+      if (std::filesystem::is_regular_file(gzip_path)) {
+        gzip = readFile(gzip_path);
+      }
+
+      writer.add(std::filesystem::relative(file, root).generic_string(),
+                 readFile(file), std::move(gzip));
+    }
+    return writer;
+  }
+
+  void write(const std::filesystem::path& out) {
+    std::ranges::sort(files_, {}, &File::path);
+
+    const uint64_t entries_offset = sizeof(AssetPackHeader);
+    const uint64_t strings_offset =
+        entries_offset + files_.size() * sizeof(AssetPackEntry);
+
+    std::string strings;
+    std::vector<AssetPackEntry> entries(files_.size());
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      const auto& file = files_[i];
+      auto& e = entries[i];
+      const auto etag = fmt::format(R"("{:016x}")", fnv1a(file.body));
+
+      e.path_offset = strings_offset + strings.size();
+      e.path_length = static_cast<uint32_t>(file.path.size());
+      strings += file.path;
+      e.etag_offset = strings_offset + strings.size();
+      e.etag_length = static_cast<uint32_t>(etag.size());
+      strings += etag;
+      e.content_type =
+          static_cast<uint32_t>(getContentTypeFromFilename(file.path));
+    }
+
+    uint64_t offset = align(strings_offset + strings.size());
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      entries[i].body_offset = offset;
+      entries[i].body_length = files_[i].body.size();
+      offset = align(offset + files_[i].body.size());
+      if (files_[i].gzip) {
+        entries[i].gzip_offset = offset;
+        entries[i].gzip_length = files_[i].gzip->size();
+        offset = align(offset + files_[i].gzip->size());
+      } else {
+        entries[i].gzip_offset = offset;
+      }
+    }
+
+    AssetPackHeader header{};
+    std::memcpy(header.magic, asset_pack_magic, sizeof(header.magic));
+    header.version = asset_pack_version;
+    header.entry_count = static_cast<uint32_t>(files_.size());
+    header.entries_offset = entries_offset;
+    header.strings_offset = strings_offset;
+    header.strings_length = strings.size();
+    header.file_size = offset;
+
+    std::ofstream ofs(out, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      throw AssetPackError(
+          fmt::format("Cannot write asset pack '{}'", out.string()));
+    }
+
+    uint64_t written = 0;
+    auto put = [&ofs, &written](const char* data, std::size_t length) {
+      ofs.write(data, static_cast<std::streamsize>(length));
+      written += length;
+    };
+    auto pad = [&put, &written](uint64_t to) {
+      static const std::vector<char> zeros(asset_pack_alignment, '\0');
+      put(zeros.data(), to - written);
+    };
+
+    put(reinterpret_cast<const char*>(&header), sizeof(header));
+    put(reinterpret_cast<const char*>(entries.data()),
+        entries.size() * sizeof(AssetPackEntry));
+    put(strings.data(), strings.size());
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      pad(entries[i].body_offset);
+      put(files_[i].body.data(), files_[i].body.size());
+      if (files_[i].gzip) {
+        pad(entries[i].gzip_offset);
+        put(files_[i].gzip->data(), files_[i].gzip->size());
+      }
+    }
+    pad(offset);
+
+    if (!ofs) {
+      throw AssetPackError(
+          fmt::format("Failed writing asset pack '{}'", out.string()));
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return files_.size(); }
+
+ private:
+  struct File {
+    std::string path;
+    std::vector<char> body;
+    std::optional<std::vector<char>> gzip;
+  };
+
+  std::vector<File> files_;
+
+  static uint64_t align(uint64_t offset) {
+    return (offset + asset_pack_alignment - 1) & ~(asset_pack_alignment - 1);
+  }
+
+  static uint64_t fnv1a(const std::vector<char>& data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : data) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  static std::vector<char> readFile(const std::filesystem::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(ifs),
+            std::istreambuf_iterator<char>()};
+  }
+};
+
+}  // namespace httpxx
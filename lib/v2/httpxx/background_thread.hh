@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <csignal>
+#include <thread>
+#include <utility>
+
+namespace httpxx {
+
+// Starts a helper thread, e.g. a log writer, with the signals Socket::Listen
+// reads through a signalfd blocked. The kernel delivers a process-directed
+// signal to any thread that leaves it unblocked, so a helper started before
+// Listen() would otherwise take SIGTERM with its default action. The mask is
+// set before the thread exists, leaving no window in which it is open.
+template <typename Fn>
+std::jthread startBackgroundThread(Fn&& fn) {
+  sigset_t signals{};
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGUSR1);
+
+  sigset_t previous_mask{};
+  pthread_sigmask(SIG_BLOCK, &signals, &previous_mask);
+  try {
+    std::jthread thread(std::forward<Fn>(fn));
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+    return thread;
+  } catch (...) {
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+    throw;
+  }
+}
+
+}  // namespace httpxx
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace httpxx {
+
+// Per-thread free lists of fixed-size I/O buffers (4K, 16K and 64K). Buffers
+// are handed out uninitialised and go back to the list they came from when
+// the owning PooledBuffer is destroyed, which must happen on the same thread.
+// Each list keeps at most max_free buffers; the rest go back to the system.
+class BufferPool {
+ public:
+  static constexpr std::array<std::size_t, 3> class_sizes{4 * 1024, 16 * 1024,
+                                                           64 * 1024};
+  static constexpr std::size_t max_free = 64;
+
+  class PooledBuffer {
+   public:
+    using value_type = char;
+
+    PooledBuffer() = default;
+
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : pool_(std::exchange(other.pool_, nullptr)),
+          data_(std::exchange(other.data_, nullptr)),
+          size_class_(other.size_class_),
+          size_(std::exchange(other.size_, 0)),
+          truncated_(std::exchange(other.truncated_, false)) {}
+
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+      if (this != &other) {
+        release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        size_class_ = other.size_class_;
+        size_ = std::exchange(other.size_, 0);
+        truncated_ = std::exchange(other.truncated_, false);
+      }
+      return *this;
+    }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    ~PooledBuffer() { release(); }
+
+    [[nodiscard]] char* data() { return data_; }
+    [[nodiscard]] const char* data() const { return data_; }
+    [[nodiscard]] std::size_t capacity() const {
+      return data_ ? class_sizes[size_class_] : 0;
+    }
+
+    // Number of bytes in use, maintained by the caller.
+    [[nodiscard]] std::size_t size() const { return size_; }
+    void resize(std::size_t size) { size_ = size; }
+    [[nodiscard]] std::size_t available() const { return capacity() - size_; }
+    [[nodiscard]] std::string_view view() const { return {data_, size_}; }
+
+    [[nodiscard]] bool empty() const { return data_ == nullptr; }
+
+    // Set once an append did not fit even in the largest class; the bytes
+    // that did not fit were dropped.
+    [[nodiscard]] bool truncated() const { return truncated_; }
+
+    PooledBuffer& append(std::string_view text) {
+      while (text.size() > available() && grow()) {
+      }
+      if (text.size() > available()) {
+        truncated_ = true;
+        text = text.substr(0, available());
+      }
+      if (text.empty()) {
+        return *this;
+      }
+      std::memcpy(data_ + size_, text.data(), text.size());
+      size_ += text.size();
+      return *this;
+    }
+
+    void push_back(char c) { append(std::string_view(&c, 1)); }
+
+    // Drops the first count bytes, keeping whatever follows them.
+    void consume(std::size_t count) {
+      if (count >= size_) {
+        size_ = 0;
+        return;
+      }
+      std::memmove(data_, data_ + count, size_ - count);
+      size_ -= count;
+    }
+
+    // Moves the contents into the next size class. Returns false when the
+    // buffer is already the largest one.
+    bool grow() {
+      if (pool_ == nullptr || size_class_ + 1 >= class_sizes.size()) {
+        return false;
+      }
+      PooledBuffer bigger = pool_->acquireClass(size_class_ + 1);
+      std::memcpy(bigger.data_, data_, size_);
+      bigger.size_ = size_;
+      bigger.truncated_ = truncated_;
+      *this = std::move(bigger);
+      return true;
+    }
+
+    void release() {
+      if (data_) {
+        pool_->recycle(data_, size_class_);
+        data_ = nullptr;
+        size_ = 0;
+        truncated_ = false;
+      }
+    }
+
+   private:
+    friend class BufferPool;
+
+    PooledBuffer(BufferPool* pool, char* data, std::size_t size_class)
+        : pool_(pool), data_(data), size_class_(size_class) {}
+
+    BufferPool* pool_{nullptr};
+    char* data_{nullptr};
+    std::size_t size_class_{0};
+    std::size_t size_{0};
+    bool truncated_{false};
+  };
+
+  BufferPool() = default;
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  ~BufferPool() { trim(0); }
+
+  static BufferPool& local() {
+    thread_local BufferPool pool;
+    return pool;
+  }
+
+  // Smallest buffer holding at least min_size bytes, capped at the largest
+  // class.
+  [[nodiscard]] PooledBuffer acquire(std::size_t min_size = 0) {
+    std::size_t size_class = 0;
+    while (size_class + 1 < class_sizes.size() &&
+           class_sizes[size_class] < min_size) {
+      ++size_class;
+    }
+    return acquireClass(size_class);
+  }
+
+  // Frees cached buffers until each list holds at most keep of them.
+  void trim(std::size_t keep = 0) {
+    for (std::size_t i = 0; i < class_sizes.size(); ++i) {
+      while (free_count_[i] > keep) {
+        FreeNode* node = free_[i];
+        free_[i] = node->next;
+        --free_count_[i];
+        ::operator delete(node, class_sizes[i]);
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t freeCount(std::size_t size_class) const {
+    return free_count_[size_class];
+  }
+
+  [[nodiscard]] std::size_t outstanding() const { return outstanding_; }
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  std::array<FreeNode*, class_sizes.size()> free_{};
+  std::array<std::size_t, class_sizes.size()> free_count_{};
+  std::size_t outstanding_{0};
+
+  PooledBuffer acquireClass(std::size_t size_class) {
+    ++outstanding_;
+    if (FreeNode* node = free_[size_class]) {
+      free_[size_class] = node->next;
+      --free_count_[size_class];
+      return {this, reinterpret_cast<char*>(node), size_class};
+    }
+    return {this,
+            static_cast<char*>(::operator new(class_sizes[size_class])),
+            size_class};
+  }
+
+  void recycle(char* data, std::size_t size_class) {
+    --outstanding_;
+    if (free_count_[size_class] >= max_free) {
+      ::operator delete(data, class_sizes[size_class]);
+      return;
+    }
+    auto* node = ::new (data) FreeNode{free_[size_class]};
+    free_[size_class] = node;
+    ++free_count_[size_class];
+  }
+};
+
+using PooledBuffer = BufferPool::PooledBuffer;
+
+}  // namespace httpxx
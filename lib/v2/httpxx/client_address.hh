@@ -0,0 +1,53 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace httpxx {
+
+// Peer address of a connection, as returned by accept(), without the port.
+// IPv4 addresses are kept in their first four bytes.
+struct ClientAddress {
+  std::array<uint8_t, 16> bytes{};
+  sa_family_t family{AF_UNSPEC};
+
+  static ClientAddress from(const sockaddr_storage& storage) {
+    ClientAddress address;
+    address.family = storage.ss_family;
+    if (storage.ss_family == AF_INET) {
+      const auto& in = reinterpret_cast<const sockaddr_in&>(storage);
+      std::memcpy(address.bytes.data(), &in.sin_addr, sizeof(in.sin_addr));
+    } else if (storage.ss_family == AF_INET6) {
+      const auto& in6 = reinterpret_cast<const sockaddr_in6&>(storage);
+      std::memcpy(address.bytes.data(), &in6.sin6_addr, sizeof(in6.sin6_addr));
+    }
+    return address;
+  }
+
+  [[nodiscard]] std::string toString() const {
+    std::array<char, INET6_ADDRSTRLEN> text{};
+    if (family != AF_INET && family != AF_INET6) {
+      return "-";
+    }
+    ::inet_ntop(family, bytes.data(), text.data(), text.size());
+    return text.data();
+  }
+
+  [[nodiscard]] uint64_t hash() const {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    std::memcpy(&high, bytes.data(), sizeof(high));
+    std::memcpy(&low, bytes.data() + sizeof(high), sizeof(low));
+    return high ^ (low * 0x9e3779b97f4a7c15ULL) ^ family;
+  }
+
+  friend bool operator==(const ClientAddress&, const ClientAddress&) = default;
+};
+
+}  // namespace httpxx
@@ -3,9 +3,16 @@
 #include <fmt/format.h>
 #include <netinet/in.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <include/tomlpp.hh>
 #include <iostream>
+#include <thread>
+
+#include "httpxx/access_log.hh"
+#include "httpxx/rate_limiter.hh"
 
 namespace httpxx {
 
@@ -34,6 +41,79 @@ class Config {
       config.port_ = getRequiredValue<in_port_t>(table, "server", "port");
       config.www_path_ =
           getRequiredValue<std::string>(table, "server", "www_path");
+      config.fd_cache_capacity_ = getOptionalValue<std::size_t>(
+          table, "server", "fd_cache_capacity", config.fd_cache_capacity_);
+      config.fd_cache_revalidate_interval_ =
+          std::chrono::milliseconds(getOptionalValue<int64_t>(
+              table, "server", "fd_cache_revalidate_ms",
+              config.fd_cache_revalidate_interval_.count()));
+
+      config.asset_pack_ = getOptionalValue<std::string>(
+          table, "server", "asset_pack", config.asset_pack_.string());
+      config.workers_ = getOptionalValue<std::size_t>(
+          table, "server", "workers", config.workers_);
+      config.header_timeout_ = getOptionalMillis(
+          table, "header_timeout_ms", config.header_timeout_);
+      config.body_timeout_ =
+          getOptionalMillis(table, "body_timeout_ms", config.body_timeout_);
+      config.keep_alive_timeout_ = getOptionalMillis(
+          table, "keep_alive_timeout_ms", config.keep_alive_timeout_);
+      config.write_timeout_ =
+          getOptionalMillis(table, "write_timeout_ms", config.write_timeout_);
+      config.drain_timeout_ =
+          getOptionalMillis(table, "drain_timeout_ms", config.drain_timeout_);
+      config.handle_signals_ = getOptionalValue<bool>(
+          table, "server", "handle_signals", config.handle_signals_);
+      config.handoff_socket_ = getOptionalValue<std::string>(
+          table, "server", "handoff_socket", config.handoff_socket_.string());
+      config.shed_target_ =
+          getOptionalMillis(table, "shed_target_ms", config.shed_target_);
+      config.shed_interval_ =
+          getOptionalMillis(table, "shed_interval_ms", config.shed_interval_);
+      config.shed_backlog_ = getOptionalValue<std::size_t>(
+          table, "server", "shed_backlog", config.shed_backlog_);
+      config.retry_after_ = std::chrono::seconds(getOptionalValue<int64_t>(
+          table, "server", "retry_after_s", config.retry_after_.count()));
+      config.rate_limit_.rate = getOptionalValue<double>(
+          table, "server", "rate_limit_rps", config.rate_limit_.rate);
+      config.rate_limit_.burst = getOptionalValue<double>(
+          table, "server", "rate_limit_burst", config.rate_limit_.burst);
+      config.rate_limit_header_ = getOptionalValue<std::string>(
+          table, "server", "rate_limit_header", config.rate_limit_header_);
+      config.metrics_path_ = getOptionalValue<std::string>(
+          table, "server", "metrics_path", config.metrics_path_);
+      config.access_log_ = getOptionalValue<std::string>(
+          table, "server", "access_log", config.access_log_.string());
+      if (const auto format = getOptionalValue<std::string>(
+              table, "server", "access_log_format", "");
+          !format.empty()) {
+        try {
+          config.access_log_format_ = accessLogFormatFromString(format);
+        } catch (const std::invalid_argument& e) {
+          throw ConfigError(e.what());
+        }
+      }
+      config.access_log_max_bytes_ = getOptionalValue<uint64_t>(
+          table, "server", "access_log_max_bytes",
+          config.access_log_max_bytes_);
+      config.access_log_keep_ = getOptionalValue<std::size_t>(
+          table, "server", "access_log_keep", config.access_log_keep_);
+      config.trace_export_ = getOptionalValue<std::string>(
+          table, "server", "trace_export", config.trace_export_);
+      config.trace_sample_rate_ = getOptionalValue<double>(
+          table, "server", "trace_sample_rate", config.trace_sample_rate_);
+      config.flight_recorder_size_ =
+          getOptionalValue<std::size_t>(table, "server", "flight_recorder_size",
+                                        config.flight_recorder_size_);
+      config.flight_recorder_dump_ = getOptionalValue<std::string>(
+          table, "server", "flight_recorder_dump",
+          config.flight_recorder_dump_.string());
+      config.flight_recorder_route_ = getOptionalValue<std::string>(
+          table, "server", "flight_recorder_route",
+          config.flight_recorder_route_);
+      config.perf_counter_sample_rate_ = getOptionalValue<double>(
+          table, "server", "perf_counter_sample_rate",
+          config.perf_counter_sample_rate_);
 
       config.validateWwwPath();
       std::clog << fmt::format("Correctly loaded config: www_path: {}\n",
@@ -50,6 +130,132 @@ class Config {
     return www_path_;
   }
 
+  [[nodiscard]] std::size_t getFdCacheCapacity() const {
+    return fd_cache_capacity_;
+  }
+  [[nodiscard]] std::chrono::milliseconds getFdCacheRevalidateInterval()
+      const {
+    return fd_cache_revalidate_interval_;
+  }
+
+  [[nodiscard]] const std::filesystem::path& getAssetPack() const {
+    return asset_pack_;
+  }
+
+  // Number of event loop threads; 0 means one per hardware thread.
+  [[nodiscard]] std::size_t getWorkers() const {
+    if (workers_ == 0) {
+      return std::max(1u, std::thread::hardware_concurrency());
+    }
+    return workers_;
+  }
+
+  // Timeouts enforced by the event loop; zero disables one. The header
+  // timeout bounds the whole request head, the others reset on progress.
+  [[nodiscard]] std::chrono::milliseconds getHeaderTimeout() const {
+    return header_timeout_;
+  }
+  [[nodiscard]] std::chrono::milliseconds getBodyTimeout() const {
+    return body_timeout_;
+  }
+  [[nodiscard]] std::chrono::milliseconds getKeepAliveTimeout() const {
+    return keep_alive_timeout_;
+  }
+  [[nodiscard]] std::chrono::milliseconds getWriteTimeout() const {
+    return write_timeout_;
+  }
+
+  // How long a stopping server waits for in-flight requests.
+  [[nodiscard]] std::chrono::milliseconds getDrainTimeout() const {
+    return drain_timeout_;
+  }
+
+  // Whether Server::start() drains and returns on SIGTERM and SIGINT.
+  [[nodiscard]] bool getHandleSignals() const { return handle_signals_; }
+
+  // AF_UNIX socket used to pass the listener to a replacement process.
+  [[nodiscard]] const std::filesystem::path& getHandoffSocket() const {
+    return handoff_socket_;
+  }
+
+  // Load shedding: requests are answered with 503 once they have waited
+  // longer than the target for a whole interval (0 disables that), and every
+  // connection accepted while more than shed_backlog connections wait in the
+  // listen backlog is turned away (0 disables that). Critical routes are
+  // never shed. Retry-After tells clients when to come back.
+  [[nodiscard]] std::chrono::milliseconds getShedTarget() const {
+    return shed_target_;
+  }
+  [[nodiscard]] std::chrono::milliseconds getShedInterval() const {
+    return shed_interval_;
+  }
+  [[nodiscard]] std::size_t getShedBacklog() const { return shed_backlog_; }
+  [[nodiscard]] std::chrono::seconds getRetryAfter() const {
+    return retry_after_;
+  }
+
+  // Requests per second and burst allowed per client on routes without a
+  // limit of their own. Clients are told apart by their address and, when
+  // the rate limit header is set and present, its value as well. The value
+  // is read before middleware runs, so it must be a credential that the
+  // application rejects when unknown; otherwise a client can open a new
+  // bucket per value.
+  [[nodiscard]] const RateLimit& getRateLimit() const { return rate_limit_; }
+  [[nodiscard]] const std::string& getRateLimitHeader() const {
+    return rate_limit_header_;
+  }
+
+  // Route serving Prometheus metrics; empty disables it.
+  [[nodiscard]] const std::string& getMetricsPath() const {
+    return metrics_path_;
+  }
+
+  // File requests are logged to; empty disables the access log. Once it
+  // grows past getAccessLogMaxBytes(), when non-zero, it is rotated and
+  // getAccessLogKeep() old files are kept.
+  [[nodiscard]] const std::filesystem::path& getAccessLog() const {
+    return access_log_;
+  }
+  [[nodiscard]] AccessLogFormat getAccessLogFormat() const {
+    return access_log_format_;
+  }
+  [[nodiscard]] uint64_t getAccessLogMaxBytes() const {
+    return access_log_max_bytes_;
+  }
+  [[nodiscard]] std::size_t getAccessLogKeep() const {
+    return access_log_keep_;
+  }
+
+  // Where sampled traces are exported: a file, or unix:/path for a
+  // collector socket. Empty disables tracing. Requests without a sampled
+  // traceparent start a trace with probability getTraceSampleRate().
+  [[nodiscard]] const std::string& getTraceExport() const {
+    return trace_export_;
+  }
+  [[nodiscard]] double getTraceSampleRate() const {
+    return trace_sample_rate_;
+  }
+
+  // Requests each worker keeps in its flight recorder; 0 disables it. The
+  // recorder is dumped to getFlightRecorderDump() on SIGUSR1, when set, and
+  // served on getFlightRecorderRoute(), when set.
+  [[nodiscard]] std::size_t getFlightRecorderSize() const {
+    return flight_recorder_size_;
+  }
+  [[nodiscard]] const std::filesystem::path& getFlightRecorderDump() const {
+    return flight_recorder_dump_;
+  }
+  [[nodiscard]] const std::string& getFlightRecorderRoute() const {
+    return flight_recorder_route_;
+  }
+
+  // Share of requests whose phases are measured with hardware performance
+  // counters; 0 disables them. Only honoured in builds with
+  // HTTPXX_PERF_COUNTERS defined, see perf_counters.hh.
+  [[nodiscard]] double getPerfCounterSampleRate() const {
+    return perf_counter_sample_rate_;
+  }
+
   [[nodiscard]] bool isValid() const {
     return port_ != 0 && !www_path_.empty() &&
            std::filesystem::exists(www_path_);
@@ -66,8 +272,168 @@ class Config {
     return *this;
   }
 
+  Config& setFdCacheCapacity(std::size_t capacity) {
+    fd_cache_capacity_ = capacity;
+    return *this;
+  }
+
+  Config& setFdCacheRevalidateInterval(std::chrono::milliseconds interval) {
+    fd_cache_revalidate_interval_ = interval;
+    return *this;
+  }
+
+  Config& setAssetPack(std::filesystem::path path) {
+    asset_pack_ = std::move(path);
+    return *this;
+  }
+
+  Config& setWorkers(std::size_t workers) {
+    workers_ = workers;
+    return *this;
+  }
+
+  Config& setHeaderTimeout(std::chrono::milliseconds timeout) {
+    header_timeout_ = timeout;
+    return *this;
+  }
+
+  Config& setBodyTimeout(std::chrono::milliseconds timeout) {
+    body_timeout_ = timeout;
+    return *this;
+  }
+
+  Config& setKeepAliveTimeout(std::chrono::milliseconds timeout) {
+    keep_alive_timeout_ = timeout;
+    return *this;
+  }
+
+  Config& setWriteTimeout(std::chrono::milliseconds timeout) {
+    write_timeout_ = timeout;
+    return *this;
+  }
+
+  Config& setDrainTimeout(std::chrono::milliseconds timeout) {
+    drain_timeout_ = timeout;
+    return *this;
+  }
+
+  Config& setHandleSignals(bool handle_signals) {
+    handle_signals_ = handle_signals;
+    return *this;
+  }
+
+  Config& setHandoffSocket(std::filesystem::path path) {
+    handoff_socket_ = std::move(path);
+    return *this;
+  }
+
+  Config& setShedTarget(std::chrono::milliseconds target) {
+    shed_target_ = target;
+    return *this;
+  }
+
+  Config& setShedInterval(std::chrono::milliseconds interval) {
+    shed_interval_ = interval;
+    return *this;
+  }
+
+  Config& setShedBacklog(std::size_t backlog) {
+    shed_backlog_ = backlog;
+    return *this;
+  }
+
+  Config& setRetryAfter(std::chrono::seconds retry_after) {
+    retry_after_ = retry_after;
+    return *this;
+  }
+
+  Config& setRateLimit(RateLimit limit) {
+    rate_limit_ = limit;
+    return *this;
+  }
+
+  Config& setRateLimitHeader(std::string header) {
+    rate_limit_header_ = std::move(header);
+    return *this;
+  }
+
+  Config& setMetricsPath(std::string path) {
+    metrics_path_ = std::move(path);
+    return *this;
+  }
+
+  Config& setAccessLog(std::filesystem::path path) {
+    access_log_ = std::move(path);
+    return *this;
+  }
+
+  Config& setAccessLogFormat(AccessLogFormat format) {
+    access_log_format_ = format;
+    return *this;
+  }
+
+  Config& setAccessLogRotation(uint64_t max_bytes, std::size_t keep) {
+    access_log_max_bytes_ = max_bytes;
+    access_log_keep_ = keep;
+    return *this;
+  }
+
+  Config& setTracing(std::string destination, double sample_rate) {
+    trace_export_ = std::move(destination);
+    trace_sample_rate_ = sample_rate;
+    return *this;
+  }
+
+  Config& setFlightRecorderSize(std::size_t size) {
+    flight_recorder_size_ = size;
+    return *this;
+  }
+
+  Config& setFlightRecorderDump(std::filesystem::path path) {
+    flight_recorder_dump_ = std::move(path);
+    return *this;
+  }
+
+  Config& setFlightRecorderRoute(std::string route) {
+    flight_recorder_route_ = std::move(route);
+    return *this;
+  }
+
+  Config& setPerfCounterSampleRate(double sample_rate) {
+    perf_counter_sample_rate_ = sample_rate;
+    return *this;
+  }
+
   friend bool operator==(const Config& lhs, const Config& rhs) {
-    return lhs.port_ == rhs.port_ && lhs.www_path_ == rhs.www_path_;
+    return lhs.port_ == rhs.port_ && lhs.www_path_ == rhs.www_path_ &&
+           lhs.fd_cache_capacity_ == rhs.fd_cache_capacity_ &&
+           lhs.fd_cache_revalidate_interval_ ==
+               rhs.fd_cache_revalidate_interval_ &&
+           lhs.asset_pack_ == rhs.asset_pack_ && lhs.workers_ == rhs.workers_ &&
+           lhs.header_timeout_ == rhs.header_timeout_ &&
+           lhs.body_timeout_ == rhs.body_timeout_ &&
+           lhs.keep_alive_timeout_ == rhs.keep_alive_timeout_ &&
+           lhs.write_timeout_ == rhs.write_timeout_ &&
+           lhs.drain_timeout_ == rhs.drain_timeout_ &&
+           lhs.handle_signals_ == rhs.handle_signals_ &&
+           lhs.handoff_socket_ == rhs.handoff_socket_ &&
+           lhs.shed_target_ == rhs.shed_target_ &&
+           lhs.shed_interval_ == rhs.shed_interval_ &&
+           lhs.shed_backlog_ == rhs.shed_backlog_ &&
+           lhs.retry_after_ == rhs.retry_after_ &&
+           lhs.rate_limit_ == rhs.rate_limit_ &&
+           lhs.rate_limit_header_ == rhs.rate_limit_header_ &&
+           lhs.metrics_path_ == rhs.metrics_path_ &&
+           lhs.access_log_ == rhs.access_log_ &&
+           lhs.access_log_format_ == rhs.access_log_format_ &&
+           lhs.access_log_max_bytes_ == rhs.access_log_max_bytes_ &&
+           lhs.access_log_keep_ == rhs.access_log_keep_ &&
+           lhs.trace_export_ == rhs.trace_export_ &&
+           lhs.trace_sample_rate_ == rhs.trace_sample_rate_ &&
+           lhs.flight_recorder_size_ == rhs.flight_recorder_size_ &&
+           lhs.flight_recorder_dump_ == rhs.flight_recorder_dump_ &&
+           lhs.flight_recorder_route_ == rhs.flight_recorder_route_ &&
+           lhs.perf_counter_sample_rate_ == rhs.perf_counter_sample_rate_;
   }
 
   friend bool operator!=(const Config& lhs, const Config& rhs) {
@@ -77,6 +443,34 @@ class Config {
  private:
   in_port_t port_{0};
   std::filesystem::path www_path_;
+  std::size_t fd_cache_capacity_{256};
+  std::chrono::milliseconds fd_cache_revalidate_interval_{1000};
+  std::filesystem::path asset_pack_;
+  std::size_t workers_{1};
+  std::chrono::milliseconds header_timeout_{10000};
+  std::chrono::milliseconds body_timeout_{30000};
+  std::chrono::milliseconds keep_alive_timeout_{5000};
+  std::chrono::milliseconds write_timeout_{30000};
+  std::chrono::milliseconds drain_timeout_{10000};
+  bool handle_signals_{true};
+  std::filesystem::path handoff_socket_;
+  std::chrono::milliseconds shed_target_{50};
+  std::chrono::milliseconds shed_interval_{500};
+  std::size_t shed_backlog_{0};
+  std::chrono::seconds retry_after_{1};
+  RateLimit rate_limit_;
+  std::string rate_limit_header_;
+  std::string metrics_path_;
+  std::filesystem::path access_log_;
+  AccessLogFormat access_log_format_{AccessLogFormat::COMBINED};
+  uint64_t access_log_max_bytes_{0};
+  std::size_t access_log_keep_{5};
+  std::string trace_export_;
+  double trace_sample_rate_{0};
+  std::size_t flight_recorder_size_{1024};
+  std::filesystem::path flight_recorder_dump_;
+  std::string flight_recorder_route_;
+  double perf_counter_sample_rate_{0};
 
   void validateWwwPath() const {
     if (!www_path_.empty() && !std::filesystem::exists(www_path_)) {
@@ -110,6 +504,31 @@ class Config {
 
     return *value;
   }
+
+  template <typename T>
+  static T getOptionalValue(const toml::table& table,
+                            const std::string& section, const std::string& key,
+                            T fallback) {
+    auto node = table[section][key];
+    if (!node) {
+      return fallback;
+    }
+
+    auto value = node.value<T>();
+    if (!value) {
+      throw ConfigError(
+          fmt::format("Invalid type for config value: {}.{}", section, key));
+    }
+
+    return *value;
+  }
+
+  static std::chrono::milliseconds getOptionalMillis(
+      const toml::table& table, const std::string& key,
+      std::chrono::milliseconds fallback) {
+    return std::chrono::milliseconds(
+        getOptionalValue<int64_t>(table, "server", key, fallback.count()));
+  }
 };
 
 class ConfigBuilder {
@@ -124,6 +543,137 @@ class ConfigBuilder {
     return *this;
   }
 
+  ConfigBuilder& setFdCacheCapacity(std::size_t capacity) {
+    config_.setFdCacheCapacity(capacity);
+    return *this;
+  }
+
+  ConfigBuilder& setFdCacheRevalidateInterval(
+      std::chrono::milliseconds interval) {
+    config_.setFdCacheRevalidateInterval(interval);
+    return *this;
+  }
+
+  ConfigBuilder& setAssetPack(std::filesystem::path path) {
+    config_.setAssetPack(std::move(path));
+    return *this;
+  }
+
+  ConfigBuilder& setWorkers(std::size_t workers) {
+    config_.setWorkers(workers);
+    return *this;
+  }
+
+  ConfigBuilder& setHeaderTimeout(std::chrono::milliseconds timeout) {
+    config_.setHeaderTimeout(timeout);
+    return *this;
+  }
+
+  ConfigBuilder& setBodyTimeout(std::chrono::milliseconds timeout) {
+    config_.setBodyTimeout(timeout);
+    return *this;
+  }
+
+  ConfigBuilder& setKeepAliveTimeout(std::chrono::milliseconds timeout) {
+    config_.setKeepAliveTimeout(timeout);
+    return *this;
+  }
+
+  ConfigBuilder& setWriteTimeout(std::chrono::milliseconds timeout) {
+    config_.setWriteTimeout(timeout);
+    return *this;
+  }
+
+  ConfigBuilder& setDrainTimeout(std::chrono::milliseconds timeout) {
+    config_.setDrainTimeout(timeout);
+    return *this;
+  }
+
+  ConfigBuilder& setHandleSignals(bool handle_signals) {
+    config_.setHandleSignals(handle_signals);
+    return *this;
+  }
+
+  ConfigBuilder& setHandoffSocket(std::filesystem::path path) {
+    config_.setHandoffSocket(std::move(path));
+    return *this;
+  }
+
+  ConfigBuilder& setShedTarget(std::chrono::milliseconds target) {
+    config_.setShedTarget(target);
+    return *this;
+  }
+
+  ConfigBuilder& setShedInterval(std::chrono::milliseconds interval) {
+    config_.setShedInterval(interval);
+    return *this;
+  }
+
+  ConfigBuilder& setShedBacklog(std::size_t backlog) {
+    config_.setShedBacklog(backlog);
+    return *this;
+  }
+
+  ConfigBuilder& setRetryAfter(std::chrono::seconds retry_after) {
+    config_.setRetryAfter(retry_after);
+    return *this;
+  }
+
+  ConfigBuilder& setRateLimit(RateLimit limit) {
+    config_.setRateLimit(limit);
+    return *this;
+  }
+
+  ConfigBuilder& setRateLimitHeader(std::string header) {
+    config_.setRateLimitHeader(std::move(header));
+    return *this;
+  }
+
+  ConfigBuilder& setMetricsPath(std::string path) {
+    config_.setMetricsPath(std::move(path));
+    return *this;
+  }
+
+  ConfigBuilder& setAccessLog(std::filesystem::path path) {
+    config_.setAccessLog(std::move(path));
+    return *this;
+  }
+
+  ConfigBuilder& setAccessLogFormat(AccessLogFormat format) {
+    config_.setAccessLogFormat(format);
+    return *this;
+  }
+
+  ConfigBuilder& setAccessLogRotation(uint64_t max_bytes, std::size_t keep) {
+    config_.setAccessLogRotation(max_bytes, keep);
+    return *this;
+  }
+
+  ConfigBuilder& setTracing(std::string destination, double sample_rate) {
+    config_.setTracing(std::move(destination), sample_rate);
+    return *this;
+  }
+
+  ConfigBuilder& setFlightRecorderSize(std::size_t size) {
+    config_.setFlightRecorderSize(size);
+    return *this;
+  }
+
+  ConfigBuilder& setFlightRecorderDump(std::filesystem::path path) {
+    config_.setFlightRecorderDump(std::move(path));
+    return *this;
+  }
+
+  ConfigBuilder& setFlightRecorderRoute(std::string route) {
+    config_.setFlightRecorderRoute(std::move(route));
+    return *this;
+  }
+
+  ConfigBuilder& setPerfCounterSampleRate(double sample_rate) {
+    config_.setPerfCounterSampleRate(sample_rate);
+    return *this;
+  }
+
   Config build() {
     if (!config_.isValid()) {
       throw ConfigError("Invalid configuration");
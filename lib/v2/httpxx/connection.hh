@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "httpxx/buffer_pool.hh"
+#include "httpxx/client_address.hh"
+#include "httpxx/request_handlers.hh"
+#include "httpxx/timer_wheel.hh"
+#include "httpxx/tracing.hh"
+
+namespace httpxx {
+
+// Refers to a slot in a ConnectionSlab. The generation is bumped every time
+// the slot is released, so a handle kept by an epoll registration or a timer
+// after its connection closed resolves to nullptr instead of to whichever
+// connection reuses the slot.
+struct ConnectionHandle {
+  uint32_t index{0};
+  uint32_t generation{0};
+
+  [[nodiscard]] constexpr uint64_t pack() const {
+    return (uint64_t{generation} << 32) | index;
+  }
+
+  static constexpr ConnectionHandle unpack(uint64_t packed) {
+    return {static_cast<uint32_t>(packed),
+            static_cast<uint32_t>(packed >> 32)};
+  }
+
+  friend constexpr bool operator==(ConnectionHandle,
+                                   ConnectionHandle) = default;
+};
+
+// What the connection's timer is currently waiting for. LINGER: the answer
+// to a rejected request is out and the rest of the request is discarded
+// until the client closes, see EventLoop::linger().
+enum class Deadline : uint8_t { NONE, HEADER, BODY, KEEP_ALIVE, WRITE, LINGER };
+
+// Per-connection state owned by one worker. Slots are cache-line aligned so
+// neighbouring connections never share a line.
+struct alignas(64) Connection {
+  int fd{-1};
+  uint32_t generation{1};
+  uint32_t events{0};
+  bool close_after_write{false};
+  // Closed with a lingering close after the response, as the client may
+  // still be sending a request that was rejected.
+  bool linger{false};
+  // Accepted while the listen backlog was over the limit; its request is
+  // answered with 503 unless it targets a critical route.
+  bool shed{false};
+  Deadline deadline{Deadline::NONE};
+  TimerNode timer;
+  ClientAddress client;
+  PooledBuffer input;
+  std::optional<OutgoingResponse> output;
+  // Set while output answers a request that went through the router, whose
+  // latency is recorded once it is written.
+  bool timed{false};
+  RequestTiming timing;
+  std::optional<SampledTrace> trace;
+  // The request at the front of input: how much of it has been searched for
+  // the end of its head, and its whole length once the head is complete.
+  std::size_t head_scanned{0};
+  std::size_t message_length{0};
+
+  [[nodiscard]] bool open() const { return fd >= 0; }
+};
+
+// Free-list allocator for Connection objects. Slots live in fixed chunks that
+// are only ever added, so their addresses are stable and, once the pool has
+// grown to the peak number of concurrent connections, accepting and closing
+// connections does not touch the global allocator. Not thread-safe: each
+// worker owns its own slab.
+class ConnectionSlab {
+ public:
+  static constexpr std::size_t chunk_size = 1024;
+
+  ConnectionSlab() = default;
+  ConnectionSlab(const ConnectionSlab&) = delete;
+  ConnectionSlab& operator=(const ConnectionSlab&) = delete;
+
+  [[nodiscard]] ConnectionHandle allocate(int fd, ClientAddress client = {}) {
+    if (free_.empty()) {
+      addChunk();
+    }
+
+    const uint32_t index = free_.back();
+    free_.pop_back();
+    ++live_;
+
+    Connection& connection = slot(index);
+    const ConnectionHandle handle{index, connection.generation};
+    connection.fd = fd;
+    connection.client = client;
+    connection.timer.data = handle.pack();
+    return handle;
+  }
+
+  // Returns nullptr when the handle is stale or was never valid.
+  [[nodiscard]] Connection* get(ConnectionHandle handle) {
+    if (handle.index >= capacity()) {
+      return nullptr;
+    }
+    Connection& connection = slot(handle.index);
+    return connection.open() && connection.generation == handle.generation
+               ? &connection
+               : nullptr;
+  }
+
+  // Resets the slot and invalidates every outstanding handle to it. Closing
+  // the descriptor and cancelling the timer is up to the caller.
+  void release(ConnectionHandle handle) {
+    Connection* connection = get(handle);
+    if (connection == nullptr) {
+      return;
+    }
+
+    connection->fd = -1;
+    connection->events = 0;
+    connection->close_after_write = false;
+    connection->linger = false;
+    connection->shed = false;
+    connection->deadline = Deadline::NONE;
+    connection->input.release();
+    connection->output.reset();
+    connection->head_scanned = 0;
+    connection->message_length = 0;
+    ++connection->generation;
+
+    free_.push_back(handle.index);
+    --live_;
+  }
+
+  template <typename Fn>
+  void forEach(Fn&& fn) {
+    for (uint32_t index = 0; index < capacity(); ++index) {
+      Connection& connection = slot(index);
+      if (connection.open()) {
+        fn(ConnectionHandle{index, connection.generation}, connection);
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return live_; }
+  [[nodiscard]] std::size_t capacity() const {
+    return chunks_.size() * chunk_size;
+  }
+
+ private:
+  using Chunk = std::array<Connection, chunk_size>;
+
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  std::vector<uint32_t> free_;
+  std::size_t live_{0};
+
+  Connection& slot(uint32_t index) {
+    return (*chunks_[index / chunk_size])[index % chunk_size];
+  }
+
+  void addChunk() {
+    const auto first = static_cast<uint32_t>(capacity());
+    chunks_.push_back(std::make_unique<Chunk>());
+    free_.reserve(capacity());
+    for (uint32_t i = chunk_size; i > 0; --i) {
+      free_.push_back(first + i - 1);
+    }
+  }
+};
+
+}  // namespace httpxx
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 
 #include "httpxx/objects.hh"
+#include "httpxx/rate_limiter.hh"
 
 namespace httpxx {
+// Critical endpoints, such as health checks, are served even while the
+// server sheds load.
+enum class Priority : uint8_t { NORMAL, CRITICAL };
+
 struct Endpoint {
-  using handler_t = std::function<httpxx::Response(httpxx::Request)>;
+  using handler_t = std::function<httpxx::Response(const httpxx::Request&)>;
   std::string path{};
   std::vector<httpxx::HttpMethod> accepted_methods{};
   handler_t handler{};
+  Priority priority{Priority::NORMAL};
+  // Overrides Config::getRateLimit() for this route, with its own buckets.
+  std::optional<RateLimit> rate_limit{};
 };
 
 }  // namespace httpxx
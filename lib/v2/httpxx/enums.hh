@@ -1,9 +1,13 @@
 #pragma once
-#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <ostream>
-#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "httpxx_assert.hh"
+#include "perfect_hash.hh"
 
 namespace httpxx {
 enum class HttpMethod {
@@ -79,27 +83,26 @@ inline std::string operator+(const HttpMethod& method) {
   }
 }
 
-inline HttpMethod stringToHttpMethod(const std::string& method) {
-  static const std::unordered_map<std::string, HttpMethod> strToHM{
-      {"GET", HttpMethod::GET},         {"HEAD", HttpMethod::HEAD},
-      {"POST", HttpMethod::POST},       {"PUT", HttpMethod::PUT},
-      {"DELETE", HttpMethod::DELETE},   {"CONNECT", HttpMethod::CONNECT},
-      {"OPTIONS", HttpMethod::OPTIONS}, {"TRACE", HttpMethod::TRACE},
-      {"PATCH", HttpMethod::PATCH}};
-
-  httpxx_assert(strToHM.contains(method), "Unknown method.");
-  return strToHM.at(method);
+inline constexpr PerfectHashMap<HttpMethod, 9> http_methods{{{
+    {"GET", HttpMethod::GET},
+    {"HEAD", HttpMethod::HEAD},
+    {"POST", HttpMethod::POST},
+    {"PUT", HttpMethod::PUT},
+    {"DELETE", HttpMethod::DELETE},
+    {"CONNECT", HttpMethod::CONNECT},
+    {"OPTIONS", HttpMethod::OPTIONS},
+    {"TRACE", HttpMethod::TRACE},
+    {"PATCH", HttpMethod::PATCH},
+}}};
+
+inline HttpMethod stringToHttpMethod(std::string_view method) {
+  const HttpMethod* found = http_methods.find(method);
+  httpxx_assert(found != nullptr, "Unknown method.");
+  return *found;
 }
 
-inline bool isValidHttpMethod(const std::string& method) {
-  static const std::unordered_map<std::string, HttpMethod> strToHM{
-      {"GET", HttpMethod::GET},         {"HEAD", HttpMethod::HEAD},
-      {"POST", HttpMethod::POST},       {"PUT", HttpMethod::PUT},
-      {"DELETE", HttpMethod::DELETE},   {"CONNECT", HttpMethod::CONNECT},
-      {"OPTIONS", HttpMethod::OPTIONS}, {"TRACE", HttpMethod::TRACE},
-      {"PATCH", HttpMethod::PATCH}};
-
-  return strToHM.contains(method);
+inline bool isValidHttpMethod(std::string_view method) {
+  return http_methods.contains(method);
 }
 
 enum class StatusCodes {
@@ -144,6 +147,7 @@ enum class StatusCodes {
   UNSUPPORTED_MEDIA_TYPE = 415,
   REQ_RANGE_NOT_SATISFIABLE = 416,
   EXPECTATION_FAILED = 417,
+  TOO_MANY_REQUESTS = 429,
 
   /*5xx Server Error*/
   INTERNAL_SERVER_ERROR = 500,
@@ -254,6 +258,9 @@ inline std::string operator+(const StatusCodes& method) {
     case StatusCodes::EXPECTATION_FAILED:
       str = "EXPECTATION_FAILED";
       break;
+    case StatusCodes::TOO_MANY_REQUESTS:
+      str = "TOO_MANY_REQUESTS";
+      break;
     case StatusCodes::INTERNAL_SERVER_ERROR:
       str = "INTERNAL_SERVER_ERROR";
       break;
@@ -350,310 +357,206 @@ enum class ContentType {
   UNKNOWN
 };
 
-inline std::string contentTypeToString(ContentType type) {
-  switch (type) {
-    case ContentType::TEXT_PLAIN:
-      return "text/plain";
-    case ContentType::TEXT_HTML:
-      return "text/html";
-    case ContentType::TEXT_CSS:
-      return "text/css";
-    case ContentType::TEXT_JAVASCRIPT:
-      return "text/javascript";
-    case ContentType::TEXT_CSV:
-      return "text/csv";
-    case ContentType::TEXT_XML:
-      return "text/xml";
-    case ContentType::TEXT_MARKDOWN:
-      return "text/markdown";
+inline constexpr std::array<std::pair<ContentType, std::string_view>,
+                            static_cast<std::size_t>(ContentType::UNKNOWN) + 1>
+    content_type_names{{
+        {ContentType::TEXT_PLAIN, "text/plain"},
+        {ContentType::TEXT_HTML, "text/html"},
+        {ContentType::TEXT_CSS, "text/css"},
+        {ContentType::TEXT_JAVASCRIPT, "text/javascript"},
+        {ContentType::TEXT_CSV, "text/csv"},
+        {ContentType::TEXT_XML, "text/xml"},
+        {ContentType::TEXT_MARKDOWN, "text/markdown"},
+
+        {ContentType::APPLICATION_JSON, "application/json"},
+        {ContentType::APPLICATION_XML, "application/xml"},
+        {ContentType::APPLICATION_PDF, "application/pdf"},
+        {ContentType::APPLICATION_OCTET_STREAM, "application/octet-stream"},
+        {ContentType::APPLICATION_FORM_URLENCODED,
+         "application/x-www-form-urlencoded"},
+        {ContentType::APPLICATION_GRAPHQL, "application/graphql"},
+        {ContentType::APPLICATION_WASM, "application/wasm"},
+
+        {ContentType::MULTIPART_FORM_DATA, "multipart/form-data"},
+        {ContentType::MULTIPART_MIXED, "multipart/mixed"},
+        {ContentType::MULTIPART_ALTERNATIVE, "multipart/alternative"},
+        {ContentType::MULTIPART_RELATED, "multipart/related"},
+
+        {ContentType::IMAGE_JPEG, "image/jpeg"},
+        {ContentType::IMAGE_PNG, "image/png"},
+        {ContentType::IMAGE_GIF, "image/gif"},
+        {ContentType::IMAGE_WEBP, "image/webp"},
+        {ContentType::IMAGE_SVG, "image/svg+xml"},
+        {ContentType::IMAGE_TIFF, "image/tiff"},
+        {ContentType::IMAGE_BMP, "image/bmp"},
+
+        {ContentType::AUDIO_MPEG, "audio/mpeg"},
+        {ContentType::AUDIO_WAV, "audio/wav"},
+        {ContentType::AUDIO_FLAC, "audio/flac"},
+        {ContentType::AUDIO_OGG, "audio/ogg"},
+        {ContentType::AUDIO_WEBM, "audio/webm"},
+        {ContentType::AUDIO_MP4, "audio/mp4"},
+
+        {ContentType::VIDEO_MP4, "video/mp4"},
+        {ContentType::VIDEO_WEBM, "video/webm"},
+        {ContentType::VIDEO_AVI, "video/x-msvideo"},
+        {ContentType::VIDEO_QUICKTIME, "video/quicktime"},
+        {ContentType::VIDEO_MKV, "video/x-matroska"},
+
+        {ContentType::FONT_WOFF, "font/woff"},
+        {ContentType::FONT_WOFF2, "font/woff2"},
+        {ContentType::FONT_TTF, "font/ttf"},
+        {ContentType::FONT_OTF, "font/otf"},
+        {ContentType::FONT_EOT, "application/vnd.ms-fontobject"},
+
+        {ContentType::APPLICATION_ZIP, "application/zip"},
+        {ContentType::APPLICATION_RAR, "application/x-rar-compressed"},
+        {ContentType::APPLICATION_GZIP, "application/gzip"},
+        {ContentType::APPLICATION_TAR, "application/x-tar"},
+        {ContentType::APPLICATION_7Z, "application/x-7z-compressed"},
+
+        {ContentType::APPLICATION_WORD, "application/msword"},
+        {ContentType::APPLICATION_WORD_XML,
+         "application/"
+         "vnd.openxmlformats-officedocument.wordprocessingml.document"},
+        {ContentType::APPLICATION_EXCEL, "application/vnd.ms-excel"},
+        {ContentType::APPLICATION_EXCEL_XML,
+         "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+        {ContentType::APPLICATION_POWERPOINT, "application/vnd.ms-powerpoint"},
+        {ContentType::APPLICATION_POWERPOINT_XML,
+         "application/"
+         "vnd.openxmlformats-officedocument.presentationml.presentation"},
+
+        {ContentType::APPLICATION_XHTML, "application/xhtml+xml"},
+        {ContentType::APPLICATION_RSS, "application/rss+xml"},
+        {ContentType::APPLICATION_ATOM, "application/atom+xml"},
+        {ContentType::TEXT_EVENT_STREAM, "text/event-stream"},
+
+        {ContentType::UNKNOWN, "application/octet-stream"},
+    }};
+
+static_assert(
+    [] {
+      for (std::size_t i = 0; i < content_type_names.size(); ++i) {
+        if (content_type_names[i].first != static_cast<ContentType>(i)) {
+          return false;
+        }
+      }
+      return true;
+    }(),
+    "content_type_names must be in ContentType declaration order");
 
-    case ContentType::APPLICATION_JSON:
-      return "application/json";
-    case ContentType::APPLICATION_XML:
-      return "application/xml";
-    case ContentType::APPLICATION_PDF:
-      return "application/pdf";
-    case ContentType::APPLICATION_OCTET_STREAM:
-      return "application/octet-stream";
-    case ContentType::APPLICATION_FORM_URLENCODED:
-      return "application/x-www-form-urlencoded";
-    case ContentType::APPLICATION_GRAPHQL:
-      return "application/graphql";
-    case ContentType::APPLICATION_WASM:
-      return "application/wasm";
-
-    case ContentType::MULTIPART_FORM_DATA:
-      return "multipart/form-data";
-    case ContentType::MULTIPART_MIXED:
-      return "multipart/mixed";
-    case ContentType::MULTIPART_ALTERNATIVE:
-      return "multipart/alternative";
-    case ContentType::MULTIPART_RELATED:
-      return "multipart/related";
-
-    case ContentType::IMAGE_JPEG:
-      return "image/jpeg";
-    case ContentType::IMAGE_PNG:
-      return "image/png";
-    case ContentType::IMAGE_GIF:
-      return "image/gif";
-    case ContentType::IMAGE_WEBP:
-      return "image/webp";
-    case ContentType::IMAGE_SVG:
-      return "image/svg+xml";
-    case ContentType::IMAGE_TIFF:
-      return "image/tiff";
-    case ContentType::IMAGE_BMP:
-      return "image/bmp";
-
-    case ContentType::AUDIO_MPEG:
-      return "audio/mpeg";
-    case ContentType::AUDIO_WAV:
-      return "audio/wav";
-    case ContentType::AUDIO_FLAC:
-      return "audio/flac";
-    case ContentType::AUDIO_OGG:
-      return "audio/ogg";
-    case ContentType::AUDIO_WEBM:
-      return "audio/webm";
-    case ContentType::AUDIO_MP4:
-      return "audio/mp4";
-
-    case ContentType::VIDEO_MP4:
-      return "video/mp4";
-    case ContentType::VIDEO_WEBM:
-      return "video/webm";
-    case ContentType::VIDEO_AVI:
-      return "video/x-msvideo";
-    case ContentType::VIDEO_QUICKTIME:
-      return "video/quicktime";
-    case ContentType::VIDEO_MKV:
-      return "video/x-matroska";
-
-    case ContentType::FONT_WOFF:
-      return "font/woff";
-    case ContentType::FONT_WOFF2:
-      return "font/woff2";
-    case ContentType::FONT_TTF:
-      return "font/ttf";
-    case ContentType::FONT_OTF:
-      return "font/otf";
-    case ContentType::FONT_EOT:
-      return "application/vnd.ms-fontobject";
-
-    case ContentType::APPLICATION_ZIP:
-      return "application/zip";
-    case ContentType::APPLICATION_RAR:
-      return "application/x-rar-compressed";
-    case ContentType::APPLICATION_GZIP:
-      return "application/gzip";
-    case ContentType::APPLICATION_TAR:
-      return "application/x-tar";
-    case ContentType::APPLICATION_7Z:
-      return "application/x-7z-compressed";
-
-    case ContentType::APPLICATION_WORD:
-      return "application/msword";
-    case ContentType::APPLICATION_WORD_XML:
-      return "application/"
-             "vnd.openxmlformats-officedocument.wordprocessingml.document";
-    case ContentType::APPLICATION_EXCEL:
-      return "application/vnd.ms-excel";
-    case ContentType::APPLICATION_EXCEL_XML:
-      return "application/"
-             "vnd.openxmlformats-officedocument.spreadsheetml.sheet";
-    case ContentType::APPLICATION_POWERPOINT:
-      return "application/vnd.ms-powerpoint";
-    case ContentType::APPLICATION_POWERPOINT_XML:
-      return "application/"
-             "vnd.openxmlformats-officedocument.presentationml.presentation";
+struct MimeType {
+  ContentType type{ContentType::APPLICATION_OCTET_STREAM};
+  std::string_view name{"application/octet-stream"};
+};
 
-    case ContentType::APPLICATION_XHTML:
-      return "application/xhtml+xml";
-    case ContentType::APPLICATION_RSS:
-      return "application/rss+xml";
-    case ContentType::APPLICATION_ATOM:
-      return "application/atom+xml";
-    case ContentType::TEXT_EVENT_STREAM:
-      return "text/event-stream";
+inline constexpr std::string_view contentTypeToString(ContentType type) {
+  const auto index = static_cast<std::size_t>(type);
+  return index < content_type_names.size()
+             ? content_type_names[index].second
+             : content_type_names.back().second;
+}
 
-    case ContentType::UNKNOWN:
-    default:
-      return "application/octet-stream";
+inline constexpr auto content_types_by_name = []() consteval {
+  constexpr std::size_t count = content_type_names.size() - 1;
+  std::array<std::pair<std::string_view, ContentType>, count> entries{};
+  for (std::size_t i = 0; i < count; ++i) {
+    entries[i] = {content_type_names[i].second, content_type_names[i].first};
   }
-}
+  return PerfectHashMap<ContentType, count, true>(entries);
+}();
 
-inline ContentType stringToContentType(const std::string& contentTypeStr) {
-  if (contentTypeStr == "text/plain") return ContentType::TEXT_PLAIN;
-  if (contentTypeStr == "text/html") return ContentType::TEXT_HTML;
-  if (contentTypeStr == "text/css") return ContentType::TEXT_CSS;
-  if (contentTypeStr == "text/javascript") return ContentType::TEXT_JAVASCRIPT;
-  if (contentTypeStr == "text/csv") return ContentType::TEXT_CSV;
-  if (contentTypeStr == "text/xml") return ContentType::TEXT_XML;
-  if (contentTypeStr == "text/markdown") return ContentType::TEXT_MARKDOWN;
-
-  if (contentTypeStr == "application/json")
-    return ContentType::APPLICATION_JSON;
-  if (contentTypeStr == "application/xml") return ContentType::APPLICATION_XML;
-  if (contentTypeStr == "application/pdf") return ContentType::APPLICATION_PDF;
-  if (contentTypeStr == "application/octet-stream")
-    return ContentType::APPLICATION_OCTET_STREAM;
-  if (contentTypeStr == "application/x-www-form-urlencoded")
-    return ContentType::APPLICATION_FORM_URLENCODED;
-  if (contentTypeStr == "application/graphql")
-    return ContentType::APPLICATION_GRAPHQL;
-  if (contentTypeStr == "application/wasm")
-    return ContentType::APPLICATION_WASM;
-
-  if (contentTypeStr == "multipart/form-data")
-    return ContentType::MULTIPART_FORM_DATA;
-  if (contentTypeStr == "multipart/mixed") return ContentType::MULTIPART_MIXED;
-  if (contentTypeStr == "multipart/alternative")
-    return ContentType::MULTIPART_ALTERNATIVE;
-  if (contentTypeStr == "multipart/related")
-    return ContentType::MULTIPART_RELATED;
-
-  if (contentTypeStr == "image/jpeg") return ContentType::IMAGE_JPEG;
-  if (contentTypeStr == "image/png") return ContentType::IMAGE_PNG;
-  if (contentTypeStr == "image/gif") return ContentType::IMAGE_GIF;
-  if (contentTypeStr == "image/webp") return ContentType::IMAGE_WEBP;
-  if (contentTypeStr == "image/svg+xml") return ContentType::IMAGE_SVG;
-  if (contentTypeStr == "image/tiff") return ContentType::IMAGE_TIFF;
-  if (contentTypeStr == "image/bmp") return ContentType::IMAGE_BMP;
-
-  if (contentTypeStr == "audio/mpeg") return ContentType::AUDIO_MPEG;
-  if (contentTypeStr == "audio/wav") return ContentType::AUDIO_WAV;
-  if (contentTypeStr == "audio/flac") return ContentType::AUDIO_FLAC;
-  if (contentTypeStr == "audio/ogg") return ContentType::AUDIO_OGG;
-  if (contentTypeStr == "audio/webm") return ContentType::AUDIO_WEBM;
-  if (contentTypeStr == "audio/mp4") return ContentType::AUDIO_MP4;
-
-  if (contentTypeStr == "video/mp4") return ContentType::VIDEO_MP4;
-  if (contentTypeStr == "video/webm") return ContentType::VIDEO_WEBM;
-  if (contentTypeStr == "video/x-msvideo") return ContentType::VIDEO_AVI;
-  if (contentTypeStr == "video/quicktime") return ContentType::VIDEO_QUICKTIME;
-  if (contentTypeStr == "video/x-matroska") return ContentType::VIDEO_MKV;
-
-  if (contentTypeStr == "font/woff") return ContentType::FONT_WOFF;
-  if (contentTypeStr == "font/woff2") return ContentType::FONT_WOFF2;
-  if (contentTypeStr == "font/ttf") return ContentType::FONT_TTF;
-  if (contentTypeStr == "font/otf") return ContentType::FONT_OTF;
-  if (contentTypeStr == "application/vnd.ms-fontobject")
-    return ContentType::FONT_EOT;
-
-  if (contentTypeStr == "application/zip") return ContentType::APPLICATION_ZIP;
-  if (contentTypeStr == "application/x-rar-compressed")
-    return ContentType::APPLICATION_RAR;
-  if (contentTypeStr == "application/gzip")
-    return ContentType::APPLICATION_GZIP;
-  if (contentTypeStr == "application/x-tar")
-    return ContentType::APPLICATION_TAR;
-  if (contentTypeStr == "application/x-7z-compressed")
-    return ContentType::APPLICATION_7Z;
-
-  if (contentTypeStr == "application/msword")
-    return ContentType::APPLICATION_WORD;
-  if (contentTypeStr ==
-      "application/vnd.openxmlformats-officedocument.wordprocessingml.document")
-    return ContentType::APPLICATION_WORD_XML;
-  if (contentTypeStr == "application/vnd.ms-excel")
-    return ContentType::APPLICATION_EXCEL;
-  if (contentTypeStr ==
-      "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet")
-    return ContentType::APPLICATION_EXCEL_XML;
-  if (contentTypeStr == "application/vnd.ms-powerpoint")
-    return ContentType::APPLICATION_POWERPOINT;
-  if (contentTypeStr ==
-      "application/"
-      "vnd.openxmlformats-officedocument.presentationml.presentation")
-    return ContentType::APPLICATION_POWERPOINT_XML;
-
-  if (contentTypeStr == "application/xhtml+xml")
-    return ContentType::APPLICATION_XHTML;
-  if (contentTypeStr == "application/rss+xml")
-    return ContentType::APPLICATION_RSS;
-  if (contentTypeStr == "application/atom+xml")
-    return ContentType::APPLICATION_ATOM;
-  if (contentTypeStr == "text/event-stream")
-    return ContentType::TEXT_EVENT_STREAM;
-
-  return ContentType::UNKNOWN;
+inline constexpr ContentType stringToContentType(
+    std::string_view contentTypeStr) {
+  const ContentType* found = content_types_by_name.find(contentTypeStr);
+  return found != nullptr ? *found : ContentType::UNKNOWN;
 }
 
-inline ContentType getContentTypeFromFilename(const std::string& filename) {
-  size_t dotPos = filename.find_last_of('.');
-  if (dotPos == std::string::npos || dotPos == filename.length() - 1) {
-    return ContentType::APPLICATION_OCTET_STREAM;
+inline constexpr PerfectHashMap<ContentType, 48, true>
+    content_types_by_extension{{{
+    {"txt", ContentType::TEXT_PLAIN},
+    {"html", ContentType::TEXT_HTML},
+    {"htm", ContentType::TEXT_HTML},
+    {"css", ContentType::TEXT_CSS},
+    {"js", ContentType::TEXT_JAVASCRIPT},
+    {"json", ContentType::APPLICATION_JSON},
+    {"xml", ContentType::APPLICATION_XML},
+    {"pdf", ContentType::APPLICATION_PDF},
+    {"csv", ContentType::TEXT_CSV},
+    {"md", ContentType::TEXT_MARKDOWN},
+
+    {"jpg", ContentType::IMAGE_JPEG},
+    {"jpeg", ContentType::IMAGE_JPEG},
+    {"png", ContentType::IMAGE_PNG},
+    {"gif", ContentType::IMAGE_GIF},
+    {"webp", ContentType::IMAGE_WEBP},
+    {"svg", ContentType::IMAGE_SVG},
+    {"tiff", ContentType::IMAGE_TIFF},
+    {"tif", ContentType::IMAGE_TIFF},
+    {"bmp", ContentType::IMAGE_BMP},
+
+    {"mp3", ContentType::AUDIO_MPEG},
+    {"wav", ContentType::AUDIO_WAV},
+    {"flac", ContentType::AUDIO_FLAC},
+    {"ogg", ContentType::AUDIO_OGG},
+    {"webm", ContentType::AUDIO_WEBM},
+    {"m4a", ContentType::AUDIO_MP4},
+
+    {"mp4", ContentType::VIDEO_MP4},
+    {"avi", ContentType::VIDEO_AVI},
+    {"mov", ContentType::VIDEO_QUICKTIME},
+    {"mkv", ContentType::VIDEO_MKV},
+
+    {"woff", ContentType::FONT_WOFF},
+    {"woff2", ContentType::FONT_WOFF2},
+    {"ttf", ContentType::FONT_TTF},
+    {"otf", ContentType::FONT_OTF},
+    {"eot", ContentType::FONT_EOT},
+
+    {"zip", ContentType::APPLICATION_ZIP},
+    {"rar", ContentType::APPLICATION_RAR},
+    {"gz", ContentType::APPLICATION_GZIP},
+    {"gzip", ContentType::APPLICATION_GZIP},
+    {"tar", ContentType::APPLICATION_TAR},
+    {"7z", ContentType::APPLICATION_7Z},
+
+    {"doc", ContentType::APPLICATION_WORD},
+    {"docx", ContentType::APPLICATION_WORD_XML},
+    {"xls", ContentType::APPLICATION_EXCEL},
+    {"xlsx", ContentType::APPLICATION_EXCEL_XML},
+    {"ppt", ContentType::APPLICATION_POWERPOINT},
+    {"pptx", ContentType::APPLICATION_POWERPOINT_XML},
+
+    {"xhtml", ContentType::APPLICATION_XHTML},
+    {"wasm", ContentType::APPLICATION_WASM},
+}}};
+
+inline constexpr MimeType mimeTypeFromFilename(std::string_view filename) {
+  const size_t dotPos = filename.find_last_of('.');
+  if (dotPos == std::string_view::npos) {
+    return {};
   }
 
-  std::string extension = filename.substr(dotPos + 1);
-  std::transform(extension.begin(), extension.end(), extension.begin(),
-                 ::tolower);
-
-  if (extension == "txt") return ContentType::TEXT_PLAIN;
-  if (extension == "html" || extension == "htm") return ContentType::TEXT_HTML;
-  if (extension == "css") return ContentType::TEXT_CSS;
-  if (extension == "js") return ContentType::TEXT_JAVASCRIPT;
-  if (extension == "json") return ContentType::APPLICATION_JSON;
-  if (extension == "xml") return ContentType::APPLICATION_XML;
-  if (extension == "pdf") return ContentType::APPLICATION_PDF;
-  if (extension == "csv") return ContentType::TEXT_CSV;
-  if (extension == "md") return ContentType::TEXT_MARKDOWN;
-
-  if (extension == "jpg" || extension == "jpeg") return ContentType::IMAGE_JPEG;
-  if (extension == "png") return ContentType::IMAGE_PNG;
-  if (extension == "gif") return ContentType::IMAGE_GIF;
-  if (extension == "webp") return ContentType::IMAGE_WEBP;
-  if (extension == "svg") return ContentType::IMAGE_SVG;
-  if (extension == "tiff" || extension == "tif") return ContentType::IMAGE_TIFF;
-  if (extension == "bmp") return ContentType::IMAGE_BMP;
-
-  if (extension == "mp3") return ContentType::AUDIO_MPEG;
-  if (extension == "wav") return ContentType::AUDIO_WAV;
-  if (extension == "flac") return ContentType::AUDIO_FLAC;
-  if (extension == "ogg") return ContentType::AUDIO_OGG;
-  if (extension == "webm") return ContentType::AUDIO_WEBM;
-  if (extension == "m4a") return ContentType::AUDIO_MP4;
-
-  if (extension == "mp4") return ContentType::VIDEO_MP4;
-  if (extension == "avi") return ContentType::VIDEO_AVI;
-  if (extension == "mov") return ContentType::VIDEO_QUICKTIME;
-  if (extension == "mkv") return ContentType::VIDEO_MKV;
-
-  if (extension == "woff") return ContentType::FONT_WOFF;
-  if (extension == "woff2") return ContentType::FONT_WOFF2;
-  if (extension == "ttf") return ContentType::FONT_TTF;
-  if (extension == "otf") return ContentType::FONT_OTF;
-  if (extension == "eot") return ContentType::FONT_EOT;
-
-  if (extension == "zip") return ContentType::APPLICATION_ZIP;
-  if (extension == "rar") return ContentType::APPLICATION_RAR;
-  if (extension == "gz" || extension == "gzip")
-    return ContentType::APPLICATION_GZIP;
-  if (extension == "tar") return ContentType::APPLICATION_TAR;
-  if (extension == "7z") return ContentType::APPLICATION_7Z;
-
-  if (extension == "doc") return ContentType::APPLICATION_WORD;
-  if (extension == "docx") return ContentType::APPLICATION_WORD_XML;
-  if (extension == "xls") return ContentType::APPLICATION_EXCEL;
-  if (extension == "xlsx") return ContentType::APPLICATION_EXCEL_XML;
-  if (extension == "ppt") return ContentType::APPLICATION_POWERPOINT;
-  if (extension == "pptx") return ContentType::APPLICATION_POWERPOINT_XML;
-
-  if (extension == "xhtml") return ContentType::APPLICATION_XHTML;
-  if (extension == "wasm") return ContentType::APPLICATION_WASM;
-
-  return ContentType::APPLICATION_OCTET_STREAM;
+  const ContentType* found =
+      content_types_by_extension.find(filename.substr(dotPos + 1));
+  if (found == nullptr) {
+    return {};
+  }
+  return {*found, contentTypeToString(*found)};
 }
 
-inline ContentType getContentTypeFromFilename(const std::string& filepath,
-                                              bool) {
-  size_t lastSlashPos = filepath.find_last_of("/\\");
-  std::string filename = (lastSlashPos == std::string::npos)
-                             ? filepath
-                             : filepath.substr(lastSlashPos + 1);
+inline constexpr ContentType getContentTypeFromFilename(
+    std::string_view filename) {
+  return mimeTypeFromFilename(filename).type;
+}
 
-  return getContentTypeFromFilename(filename);
+inline constexpr ContentType getContentTypeFromFilename(
+    std::string_view filepath, bool) {
+  const size_t lastSlashPos = filepath.find_last_of("/\\");
+  return getContentTypeFromFilename(lastSlashPos == std::string_view::npos
+                                        ? filepath
+                                        : filepath.substr(lastSlashPos + 1));
 }
 
 inline bool isTextFile(const ContentType type) {
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <string>
+#include <string_view>
+
+#include "httpxx/enums.hh"
+#include "httpxx/json_escape.hh"
+#include "httpxx/objects.hh"
+
+namespace httpxx {
+
+// Error responses that scanners and broken clients trigger all the time. The
+// status line, fixed headers and body of each are serialised once, on first
+// use; a response refers to them instead of building headers or JSON. The
+// 405 body has slots for the method and URI and is the only one assembled per
+// request, with a single string concatenation.
+class ErrorResponses {
+ public:
+  // Malformed request.
+  static Response badRequest() {
+    static const Prepared prepared =
+        prepare(StatusCodes::BAD_REQUEST, "text/html",
+                "<h1>400 - Bad Request</h1>");
+    return prepared.response();
+  }
+
+  // Request larger than the biggest receive buffer.
+  static Response payloadTooLarge() {
+    static const Prepared prepared =
+        prepare(StatusCodes::REQ_ENTITY_TOO_LARGE, "text/html",
+                "<h1>413 - Payload Too Large</h1>");
+    return prepared.response();
+  }
+
+  // Unknown endpoint.
+  static Response notFound() {
+    static const Prepared prepared = prepare(
+        StatusCodes::NOT_FOUND, "application/json",
+        R"({"error":"Endpoint not found"})");
+    return prepared.response();
+  }
+
+  // Missing static file.
+  static Response fileNotFound() {
+    static const Prepared prepared =
+        prepare(StatusCodes::NOT_FOUND, "text/html",
+                "<h1>404 - File Not Found</h1>");
+    return prepared.response();
+  }
+
+  static Response internalError() {
+    static const Prepared prepared =
+        prepare(StatusCodes::INTERNAL_SERVER_ERROR, "text/html",
+                "<h1>500 - Internal Server Error</h1>");
+    return prepared.response();
+  }
+
+  static Response methodNotAllowed(HttpMethod method, std::string_view uri) {
+    static const std::string head =
+        statusLine(StatusCodes::METHOD_NOT_ALLOWED) +
+        "Content-Type: application/json\r\n";
+    constexpr std::string_view prefix = R"({"error":"Method )";
+    constexpr std::string_view middle = " is not allowed on URI ";
+    constexpr std::string_view suffix = R"("})";
+
+    const auto method_name = +method;
+    std::string body;
+    body.reserve(prefix.size() + method_name.size() + middle.size() +
+                 uri.size() + suffix.size());
+    body.append(prefix);
+    appendJsonEscaped(body, method_name);
+    body.append(middle);
+    appendJsonEscaped(body, uri);
+    body.append(suffix);
+
+    Response response;
+    response.status_code = StatusCodes::METHOD_NOT_ALLOWED;
+    response.prepared_head = head;
+    response.headers.set(HeaderId::CONTENT_LENGTH, std::to_string(body.size()));
+    response.body = std::move(body);
+    return response;
+  }
+
+ private:
+  struct Prepared {
+    StatusCodes status;
+    std::string head;
+    std::string body;
+
+    [[nodiscard]] Response response() const {
+      Response response;
+      response.status_code = status;
+      response.prepared_head = head;
+      response.body = MappedBody{nullptr, body};
+      return response;
+    }
+  };
+
+  static Prepared prepare(StatusCodes status, std::string_view content_type,
+                          std::string body) {
+    auto head = statusLine(status) +
+                fmt::format("Content-Type: {}\r\nContent-Length: {}\r\n",
+                            content_type, body.size());
+    return {status, std::move(head), std::move(body)};
+  }
+
+  static std::string statusLine(StatusCodes status) {
+    return fmt::format("HTTP/1.1 {} {}\r\n", static_cast<int>(status),
+                       +status);
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,934 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+#include "httpxx/access_log.hh"
+#include "httpxx/admission.hh"
+#include "httpxx/arena.hh"
+#include "httpxx/buffer_pool.hh"
+#include "httpxx/configuration.hh"
+#include "httpxx/connection.hh"
+#include "httpxx/flight_recorder.hh"
+#include "httpxx/handoff.hh"
+#include "httpxx/metrics.hh"
+#include "httpxx/rate_limiter.hh"
+#include "httpxx/request_handlers.hh"
+#include "httpxx/router.hh"
+#include "httpxx/timer_wheel.hh"
+#include "httpxx/tracing.hh"
+
+namespace httpxx {
+
+// The listening socket shared by every worker of a server. The last worker
+// to stop watching it closes it, so once all of them are draining new
+// connections are refused instead of piling up in the backlog.
+class SharedListener {
+ public:
+  SharedListener(int fd, std::size_t workers) : fd_(fd), attached_(workers) {}
+
+  SharedListener(const SharedListener&) = delete;
+  SharedListener& operator=(const SharedListener&) = delete;
+
+  [[nodiscard]] int fd() const { return fd_; }
+
+  void detach() {
+    if (attached_.fetch_sub(1) == 1) {
+      ::close(fd_);
+    }
+  }
+
+ private:
+  int fd_;
+  std::atomic<std::size_t> attached_;
+};
+
+// One worker: an epoll instance watching the shared listening socket and the
+// connections this worker accepted. Connections are kept alive between
+// requests and pipelined requests are answered in order. A connection only
+// holds a receive buffer while a request is partially read, so idle
+// keep-alive connections cost a slab slot and a descriptor. Every connection
+// has one timer on the worker's wheel for whichever timeout applies to it.
+//
+// When stop is requested, or a signal arrives on signal_fd, the loop drains:
+// it stops accepting, closes idle connections, answers requests already in
+// flight with Connection: close and returns from run() once every connection
+// is gone or the drain timeout has passed.
+//
+// Under overload requests are answered with a canned 503 instead of waiting
+// their turn: see AdmissionControl and Config::getShedTarget(). Clients over
+// their rate limit get a 429 from the limiter shared by all workers.
+class EventLoop {
+ public:
+  static constexpr int max_events = 256;
+
+  EventLoop(const Router& router, const Config& config,
+            SharedListener& listener, RateLimiter& limiter,
+            WorkerMetrics& metrics, AccessLog::Ring* access_log,
+            Tracer::Ring* traces, FlightRecorder::Ring* flight,
+            std::stop_source stop, int signal_fd = -1)
+      : router_(router),
+        config_(config),
+        listener_(listener),
+        limiter_(limiter),
+        metrics_(metrics),
+        access_log_(access_log),
+        log_headers_(config.getAccessLogFormat() != AccessLogFormat::COMMON),
+        traces_(traces),
+        sampler_(config.getTraceSampleRate()),
+        flight_(flight),
+        perf_interval_(perfInterval(config.getPerfCounterSampleRate())),
+        stop_(std::move(stop)),
+        epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)),
+        stop_fd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        admission_(config.getShedTarget(), config.getShedInterval()),
+        unavailable_(fmt::format(
+            "HTTP/1.1 {} {}\r\nRetry-After: {}\r\nContent-Length: 0\r\n"
+            "Connection: close\r\n",
+            static_cast<int>(StatusCodes::SERVICE_UNAVAILABLE),
+            +StatusCodes::SERVICE_UNAVAILABLE,
+            config.getRetryAfter().count())),
+        too_many_requests_status_(
+            fmt::format("HTTP/1.1 {} {}\r\n",
+                        static_cast<int>(StatusCodes::TOO_MANY_REQUESTS),
+                        +StatusCodes::TOO_MANY_REQUESTS)),
+        rate_limited_(config.getRateLimit().enabled() ||
+                      router.has_rate_limits()) {
+    if (epoll_fd_ == -1 || stop_fd_ == -1) {
+      closeDescriptors();
+      throw std::runtime_error(fmt::format("[httpx::EventLoop] epoll: {}",
+                                           std::strerror(errno)));
+    }
+
+    if (!add(listener_.fd(), EPOLLIN | EPOLLEXCLUSIVE, listener_key) ||
+        !add(stop_fd_, EPOLLIN, stop_key) ||
+        (signal_fd != -1 && !add(signal_fd, EPOLLIN, signal_key))) {
+      closeDescriptors();
+      throw std::runtime_error(
+          fmt::format("[httpx::EventLoop] Cannot watch listener: {}",
+                      std::strerror(errno)));
+    }
+    signal_fd_ = signal_fd;
+
+    // Counters are per thread, and constructors run on the worker's thread.
+    if (perf_interval_ != 0) {
+      perf_counters_ = PerfCounters::open();
+    }
+  }
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+  ~EventLoop() {
+    connections_.forEach([this](ConnectionHandle handle, Connection&) {
+      closeConnection(handle);
+    });
+    if (!draining_) {
+      listener_.detach();
+    }
+    closeDescriptors();
+  }
+
+  // Serves handoff requests on the control socket; a successful handoff
+  // drains every worker.
+  void watchHandoff(ListenerHandoff& handoff) {
+    if (!add(handoff.controlFd(), EPOLLIN, handoff_key)) {
+      throw std::runtime_error(
+          fmt::format("[httpx::EventLoop] Cannot watch handoff socket: {}",
+                      std::strerror(errno)));
+    }
+    handoff_ = &handoff;
+  }
+
+  // Dumps the flight recorder of every worker to path on SIGUSR1, which the
+  // caller routes to signal_fd.
+  void watchFlightRecorder(const FlightRecorder& recorder,
+                           std::filesystem::path path) {
+    flight_recorder_ = &recorder;
+    flight_recorder_dump_ = std::move(path);
+  }
+
+  void run() {
+    std::stop_callback on_stop(stop_.get_token(), [this] {
+      const uint64_t one = 1;
+      [[maybe_unused]] auto _ = ::write(stop_fd_, &one, sizeof(one));
+    });
+
+    std::array<epoll_event, max_events> events{};
+    while (!drained()) {
+      const auto waited_from = TimerWheel::clock::now();
+      const int ready = ::epoll_wait(epoll_fd_, events.data(), max_events,
+                                     waitTimeout(waited_from));
+      if (ready == -1 && errno != EINTR) {
+        throw std::runtime_error(fmt::format(
+            "[httpx::EventLoop] epoll_wait: {}", std::strerror(errno)));
+      }
+
+      const auto now = TimerWheel::clock::now();
+      trackQueue(waited_from, now, ready);
+
+      timers_.advance(now, [this](TimerNode& timer) {
+        if (&timer == &handoff_timer_) {
+          handoff_->abandonHandOver();
+        } else {
+          closeConnection(ConnectionHandle::unpack(timer.data));
+        }
+      });
+      if (rate_limited_ && now >= next_eviction_) {
+        limiter_.evictIdle(now);
+        next_eviction_ = now + eviction_interval;
+      }
+
+      for (int i = 0; i < std::max(ready, 0); ++i) {
+        switch (events[i].data.u64) {
+          case listener_key:
+            acceptConnections();
+            break;
+          case stop_key:
+            drain();
+            break;
+          case signal_key:
+            onSignal();
+            break;
+          case handoff_key:
+            onHandoff();
+            break;
+          case handoff_ack_key:
+            onHandoffAck();
+            break;
+          default:
+            onEvent(ConnectionHandle::unpack(events[i].data.u64),
+                    events[i].events);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr uint64_t listener_key = ~uint64_t{0};
+  static constexpr uint64_t stop_key = ~uint64_t{0} - 1;
+  static constexpr uint64_t signal_key = ~uint64_t{0} - 2;
+  static constexpr uint64_t handoff_key = ~uint64_t{0} - 3;
+  static constexpr uint64_t handoff_ack_key = ~uint64_t{0} - 4;
+  static constexpr std::chrono::milliseconds eviction_interval{100};
+  static constexpr std::chrono::milliseconds linger_timeout{1000};
+
+  const Router& router_;
+  const Config& config_;
+  SharedListener& listener_;
+  RateLimiter& limiter_;
+  WorkerMetrics& metrics_;
+  AccessLog::Ring* access_log_;
+  const bool log_headers_;
+  Tracer::Ring* traces_;
+  TraceSampler sampler_;
+  FlightRecorder::Ring* flight_;
+  const FlightRecorder* flight_recorder_{nullptr};
+  const uint64_t perf_interval_;
+  uint64_t perf_countdown_{0};
+  std::unique_ptr<PerfCounters> perf_counters_;
+  std::stop_source stop_;
+  int epoll_fd_;
+  int stop_fd_;
+  int signal_fd_{-1};
+  ListenerHandoff* handoff_{nullptr};
+  TimerNode handoff_timer_;
+  std::filesystem::path flight_recorder_dump_;
+  bool draining_{false};
+  TimerWheel::clock::time_point drain_deadline_{};
+  ConnectionSlab connections_;
+  AdmissionControl admission_;
+  const std::string unavailable_;
+  TimerWheel::clock::time_point queued_since_{TimerWheel::clock::now()};
+  TimerWheel::clock::time_point last_wait_{queued_since_};
+  bool ready_list_full_{false};
+  const std::string too_many_requests_status_;
+  fmt::memory_buffer too_many_requests_;
+  const bool rate_limited_;
+  TimerWheel::clock::time_point next_eviction_{};
+  RequestArena arena_;
+  TimerWheel timers_;
+
+  bool add(int fd, uint32_t events, uint64_t key) {
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = key;
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) == 0;
+  }
+
+  void closeDescriptors() {
+    if (epoll_fd_ != -1) ::close(epoll_fd_);
+    if (stop_fd_ != -1) ::close(stop_fd_);
+  }
+
+  [[nodiscard]] bool drained() const {
+    return draining_ && (connections_.size() == 0 ||
+                         TimerWheel::clock::now() >= drain_deadline_);
+  }
+
+  [[nodiscard]] int waitTimeout(TimerWheel::clock::time_point now) const {
+    const int timeout = timers_.nextTimeout(now);
+    if (!draining_) {
+      return timeout;
+    }
+    const auto left = std::chrono::ceil<std::chrono::milliseconds>(
+        drain_deadline_ - now);
+    const int drain = static_cast<int>(std::max<int64_t>(0, left.count()));
+    return timeout == -1 ? drain : std::min(timeout, drain);
+  }
+
+  void onSignal() {
+    signalfd_siginfo info{};
+    while (::read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+      if (info.ssi_signo == SIGUSR1) {
+        dumpFlightRecorder();
+        continue;
+      }
+      std::clog << fmt::format("Received {}, shutting down\n",
+                               strsignal(static_cast<int>(info.ssi_signo)));
+      stop_.request_stop();
+    }
+  }
+
+  void dumpFlightRecorder() const {
+    if (flight_recorder_ == nullptr) {
+      return;
+    }
+    if (flight_recorder_->dumpTo(flight_recorder_dump_)) {
+      std::clog << fmt::format("Flight recorder dumped to {}\n",
+                               flight_recorder_dump_.string());
+    } else {
+      std::clog << fmt::format("[httpx::EventLoop] Cannot dump to {}: {}\n",
+                               flight_recorder_dump_.string(),
+                               std::strerror(errno));
+    }
+  }
+
+  // The new process acknowledges on its own connection, watched like any
+  // other descriptor, so this worker keeps serving while it starts up.
+  void onHandoff() {
+    const int listen_fd = listener_.fd();
+    const int peer = handoff_->offer(std::span(&listen_fd, 1));
+    if (peer == -1) {
+      return;
+    }
+    if (!add(peer, EPOLLIN, handoff_ack_key)) {
+      timers_.cancel(handoff_timer_);
+      handoff_->abandonHandOver();
+      return;
+    }
+    timers_.schedule(handoff_timer_, ListenerHandoff::ack_timeout);
+  }
+
+  void onHandoffAck() {
+    timers_.cancel(handoff_timer_);
+    if (handoff_->finishHandOver()) {
+      stop_.request_stop();
+    }
+  }
+
+  void drain() {
+    uint64_t count = 0;
+    [[maybe_unused]] auto _ = ::read(stop_fd_, &count, sizeof(count));
+    if (draining_) {
+      return;
+    }
+    draining_ = true;
+    drain_deadline_ = TimerWheel::clock::now() + config_.getDrainTimeout();
+
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, listener_.fd(), nullptr);
+    if (handoff_ != nullptr) {
+      ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, handoff_->controlFd(), nullptr);
+    }
+    listener_.detach();
+
+    // Only connections idling between requests are closed. A connection
+    // accepted just now has not sent its request yet and still gets an answer.
+    connections_.forEach([this](ConnectionHandle handle, Connection& c) {
+      if (c.deadline == Deadline::KEEP_ALIVE) {
+        closeConnection(handle);
+      } else {
+        c.close_after_write = true;
+      }
+    });
+  }
+
+  void acceptConnections() {
+    const bool backlog_exceeded = backlogExceeded();
+    while (!draining_) {
+      sockaddr_storage peer{};
+      socklen_t peer_length = sizeof(peer);
+      const int fd =
+          ::accept4(listener_.fd(), reinterpret_cast<sockaddr*>(&peer),
+                    &peer_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd == -1) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          std::clog << fmt::format("[httpx::EventLoop] accept: {}\n",
+                                   std::strerror(errno));
+        }
+        return;
+      }
+      // A file body follows its head in a second segment, which Nagle would
+      // hold back until the client's delayed ACK for the first one.
+      const int nodelay = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+      metrics_.connections_accepted.add();
+      metrics_.connections_active.add();
+      const auto handle =
+          connections_.allocate(fd, ClientAddress::from(peer));
+      if (!watch(handle, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD)) {
+        closeConnection(handle);
+        continue;
+      }
+      Connection& connection = *connections_.get(handle);
+      connection.shed = backlog_exceeded;
+      arm(connection, Deadline::HEADER);
+    }
+  }
+
+  // For a listening socket, tcpi_unacked is the length of its accept queue.
+  [[nodiscard]] bool backlogExceeded() const {
+    const auto limit = config_.getShedBacklog();
+    if (limit == 0) {
+      return false;
+    }
+    tcp_info info{};
+    socklen_t length = sizeof(info);
+    return ::getsockopt(listener_.fd(), IPPROTO_TCP, TCP_INFO, &info,
+                        &length) == 0 &&
+           info.tcpi_unacked > limit;
+  }
+
+  void onEvent(ConnectionHandle handle, uint32_t events) {
+    Connection* connection = connections_.get(handle);
+    if (connection == nullptr) {
+      return;
+    }
+
+    if ((events & EPOLLERR) != 0) {
+      closeConnection(handle);
+      return;
+    }
+
+    if (connection->deadline == Deadline::LINGER) {
+      discardInput(handle, *connection);
+      return;
+    }
+
+    if (connection->output) {
+      if ((events & EPOLLOUT) == 0) {
+        closeConnection(handle);
+      } else if (flush(handle, *connection)) {
+        serveBuffered(handle, *connection);
+      }
+      return;
+    }
+
+    readFrom(handle, *connection);
+  }
+
+  void readFrom(ConnectionHandle handle, Connection& connection) {
+    if (connection.input.empty()) {
+      connection.input = BufferPool::local().acquire();
+    } else if (connection.input.available() == 0) {
+      connection.input.grow();
+    }
+
+    const auto received =
+        ::read(connection.fd, connection.input.data() + connection.input.size(),
+               connection.input.available());
+    if (received == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        closeConnection(handle);
+      }
+      return;
+    }
+    if (received == 0) {
+      closeConnection(handle);
+      return;
+    }
+
+    connection.input.resize(connection.input.size() +
+                            static_cast<std::size_t>(received));
+    metrics_.bytes_received.add(static_cast<uint64_t>(received));
+    serveBuffered(handle, connection);
+  }
+
+  // Answers every complete request in the receive buffer until one response
+  // cannot be written straight away.
+  void serveBuffered(ConnectionHandle handle, Connection& connection) {
+    while (!connection.output) {
+      std::optional<std::size_t> length;
+      try {
+        length = pendingLength(connection);
+      } catch (const ParseError&) {
+        // Where this request ends is unknown, so is where the next begins.
+        length = connection.input.size();
+        reject(connection, ErrorResponses::badRequest());
+      }
+      if (!length && !connection.output) {
+        if (connection.message_length <= max_message_length &&
+            !bufferExhausted(connection.input)) {
+          break;
+        }
+        // The request cannot fit in the biggest buffer. Its handler must
+        // not see it cut short, so it is not dispatched at all.
+        length = connection.input.size();
+        reject(connection, ErrorResponses::payloadTooLarge());
+      }
+
+      const auto message = connection.input.view().substr(0, *length);
+      connection.deadline = Deadline::NONE;
+      if (!connection.output) {
+        answer(connection, message);
+      }
+      logAccess(connection, message);
+      connection.input.consume(*length);
+      connection.head_scanned = 0;
+      connection.message_length = 0;
+      if (!flush(handle, connection)) {
+        return;
+      }
+    }
+
+    if (connection.input.size() == 0) {
+      connection.input.release();
+      arm(connection, Deadline::KEEP_ALIVE);
+    } else if (connection.message_length != 0) {
+      arm(connection, Deadline::BODY);
+    } else {
+      arm(connection, Deadline::HEADER);
+    }
+  }
+
+  // Length of the request at the front of the input once all of it has
+  // arrived. Every call only searches the bytes received since the last,
+  // so a head or body trickling in byte by byte costs linear time.
+  static std::optional<std::size_t> pendingLength(Connection& connection) {
+    const auto data = connection.input.view();
+    if (connection.message_length == 0) {
+      const auto head =
+          RequestParser::headLength(data, connection.head_scanned);
+      if (!head) {
+        connection.head_scanned = data.size();
+        return std::nullopt;
+      }
+      connection.message_length =
+          *head + RequestParser::bodyLength(data.substr(0, *head));
+    }
+    if (data.size() < connection.message_length) {
+      return std::nullopt;
+    }
+    return connection.message_length;
+  }
+
+  void answer(Connection& connection, std::string_view message) {
+    if (shouldShed(connection, message)) {
+      connection.close_after_write = true;
+      connection.output.emplace(StatusCodes::SERVICE_UNAVAILABLE,
+                                unavailable_);
+      connection.timed = false;
+      metrics_.requests_shed.add();
+    } else if (const auto wait = rateLimited(connection, message)) {
+      connection.close_after_write |= draining_;
+      connection.output.emplace(StatusCodes::TOO_MANY_REQUESTS,
+                                tooManyRequests(*wait));
+      connection.timed = false;
+      metrics_.requests_rate_limited.add();
+    } else {
+      sampleTrace(connection, message);
+      samplePerf(connection);
+      auto response = RequestHandler::respond(
+          router_, config_, message, arena_.resource(), &connection.timing);
+      arena_.reset();
+      metrics_.countRequest(connection.timing.route, response.status_code);
+      connection.timed = true;
+      nameTrace(connection);
+
+      if (draining_) {
+        response.headers.set(HeaderId::CONNECTION, "close");
+      }
+      if (response.headers.get(HeaderId::CONNECTION) == "close") {
+        connection.close_after_write = true;
+      }
+      connection.output.emplace(std::move(response));
+    }
+  }
+
+  // Sojourn times are measured from queued_since_. Events returned by a wait
+  // that blocked became ready while it did. Events returned straight away
+  // have been ready at most since the last wait that emptied the ready list,
+  // which is further back if the batches in between were full.
+  void trackQueue(TimerWheel::clock::time_point waited_from,
+                  TimerWheel::clock::time_point now, int ready) {
+    constexpr auto blocked = std::chrono::milliseconds(1);
+    if (now - waited_from >= blocked) {
+      queued_since_ = waited_from;
+    } else if (!ready_list_full_) {
+      queued_since_ = last_wait_;
+    }
+    ready_list_full_ = ready == max_events;
+    last_wait_ = now;
+  }
+
+  // Shed requests are answered with 503 and their connection is closed.
+  // Critical routes are looked up only once a request was picked for
+  // shedding.
+  bool shouldShed(const Connection& connection, std::string_view message) {
+    if (!connection.shed) {
+      const auto now = TimerWheel::clock::now();
+      if (admission_.admit(now - queued_since_, now)) {
+        return false;
+      }
+    }
+    return !router_.is_critical(RequestParser::target(message));
+  }
+
+  // Returns how long the client has to wait when it is over the limit of the
+  // requested route, or of the server when the route has none.
+  std::optional<RateLimiter::clock::duration> rateLimited(
+      const Connection& connection, std::string_view message) {
+    if (!rate_limited_) {
+      return std::nullopt;
+    }
+
+    const auto& endpoint = router_.get_endpoint(RequestParser::target(message));
+    const bool own_limit = endpoint.rate_limit.has_value();
+    const auto& limit =
+        own_limit ? *endpoint.rate_limit : config_.getRateLimit();
+    if (!limit.enabled()) {
+      return std::nullopt;
+    }
+
+    // The header only tells apart clients sharing an address, so a value
+    // sent from elsewhere cannot drain their bucket. Values are not verified
+    // here; see Config::getRateLimit().
+    uint64_t key = connection.client.hash();
+    if (const auto& name = config_.getRateLimitHeader(); !name.empty()) {
+      if (const auto value = RequestParser::header(message, name)) {
+        key ^= std::hash<std::string_view>{}(*value) * 0xbf58476d1ce4e5b9ULL;
+      }
+    }
+    // Routes with a limit of their own count in buckets of their own.
+    if (own_limit) {
+      key ^= reinterpret_cast<uintptr_t>(&endpoint) * 0x9e3779b97f4a7c15ULL;
+    }
+    return limiter_.acquire(key, limit, TimerWheel::clock::now());
+  }
+
+  // Only Retry-After varies, so the head is a fixed status line plus one
+  // number formatted into a reused buffer.
+  [[nodiscard]] std::string_view tooManyRequests(
+      RateLimiter::clock::duration wait) {
+    const auto seconds = std::chrono::ceil<std::chrono::seconds>(wait).count();
+    too_many_requests_.clear();
+    fmt::format_to(std::back_inserter(too_many_requests_),
+                   "{}Retry-After: {}\r\nContent-Length: 0\r\n{}",
+                   too_many_requests_status_, std::max<int64_t>(1, seconds),
+                   draining_ ? "Connection: close\r\n" : "");
+    return {too_many_requests_.data(), too_many_requests_.size()};
+  }
+
+  // Answers without routing and closes the connection after the response.
+  void reject(Connection& connection, Response response) {
+    metrics_.countRequest(router_.unmatched_route(), response.status_code);
+    response.headers.set(HeaderId::CONNECTION, "close");
+    connection.close_after_write = true;
+    connection.linger = true;
+    connection.timed = false;
+    connection.output.emplace(std::move(response));
+  }
+
+  // Closing a socket with unread input makes the kernel send a reset, and
+  // the client may drop the response to its rejected request before it
+  // reads it. Instead the write side is shut down and input is read and
+  // thrown away until the client closes or linger_timeout passes.
+  void linger(ConnectionHandle handle, Connection& connection) {
+    connection.input.release();
+    if (::shutdown(connection.fd, SHUT_WR) == -1 ||
+        !watch(handle, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD)) {
+      closeConnection(handle);
+      return;
+    }
+    arm(connection, Deadline::LINGER);
+  }
+
+  // One read per event; the socket is level-triggered, so a client that
+  // keeps sending does not hold up the other connections.
+  void discardInput(ConnectionHandle handle, Connection& connection) {
+    std::array<char, 16 * 1024> sink;
+    const auto received = ::read(connection.fd, sink.data(), sink.size());
+    if (received > 0) {
+      metrics_.bytes_received.add(static_cast<uint64_t>(received));
+    } else if (received == 0 ||
+               (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      closeConnection(handle);
+    }
+  }
+
+  static constexpr std::size_t max_message_length =
+      BufferPool::class_sizes.back();
+
+  static bool bufferExhausted(const PooledBuffer& buffer) {
+    return buffer.available() == 0 &&
+           buffer.capacity() == BufferPool::class_sizes.back();
+  }
+
+  // Returns true when the response went out and the connection stays open.
+  bool flush(ConnectionHandle handle, Connection& connection) {
+    switch (connection.output->write(connection.fd)) {
+      case WriteStatus::BLOCKED:
+        watch(handle, EPOLLOUT, EPOLL_CTL_MOD);
+        arm(connection, Deadline::WRITE);
+        return false;
+      case WriteStatus::FAILED:
+        closeConnection(handle);
+        return false;
+      case WriteStatus::DONE:
+        break;
+    }
+
+    metrics_.bytes_sent.add(connection.output->bytesSent());
+    if (connection.timed) {
+      const auto written = RequestTiming::clock::now();
+      recordLatency(connection, written);
+      if (connection.timing.perf.active()) {
+        connection.timing.perf.read(RequestTiming::WRITTEN);
+        metrics_.recordCounters(connection.timing.route,
+                                connection.timing.perf);
+      }
+      if (connection.trace) {
+        exportTrace(connection, written);
+      }
+    }
+    connection.output.reset();
+    if (connection.close_after_write) {
+      if (connection.linger) {
+        linger(handle, connection);
+      } else {
+        closeConnection(handle);
+      }
+      return false;
+    }
+    if ((connection.events & EPOLLOUT) != 0) {
+      watch(handle, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+    }
+    return true;
+  }
+
+  // Hands the request to the access log, or counts it as dropped when the
+  // logger has fallen behind. Only the request line and two headers are
+  // copied; the log thread does the formatting.
+  void logAccess(const Connection& connection, std::string_view message) {
+    if (access_log_ == nullptr) {
+      return;
+    }
+    const bool pushed = access_log_->tryPush([&](AccessRecord& record) {
+      const auto& output = *connection.output;
+      record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+      record.duration_ns =
+          connection.timed
+              ? std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    connection.timing.handled - connection.timing.received)
+                    .count()
+              : 0;
+      record.bytes = output.size();
+      record.client = connection.client;
+      record.status = static_cast<uint16_t>(output.response().status_code);
+      record.request_line.assign(
+          message.substr(0, std::min(message.find("\r\n"), message.size())));
+      record.referer.assign(
+          log_headers_ ? RequestParser::header(message, "Referer").value_or("")
+                       : "");
+      record.user_agent.assign(
+          log_headers_
+              ? RequestParser::header(message, "User-Agent").value_or("")
+              : "");
+    });
+    if (!pushed) {
+      metrics_.access_log_dropped.add();
+    }
+  }
+
+  // Decided before the request is parsed: an unsampled request allocates
+  // nothing and is not looked at again.
+  void sampleTrace(Connection& connection, std::string_view message) {
+    connection.trace.reset();
+    if (traces_ == nullptr) {
+      return;
+    }
+    connection.trace =
+        sampler_.decide(RequestParser::header(message, "traceparent"));
+  }
+
+  // A span is named after the parsed method. A request that did not parse
+  // has neither a method nor a route, so its span is dropped.
+  static void nameTrace(Connection& connection) {
+    if (!connection.trace) {
+      return;
+    }
+    if (!connection.timing.method) {
+      connection.trace.reset();
+      return;
+    }
+    connection.trace->method = *connection.timing.method;
+  }
+
+  // Every perf_interval_-th request reads the hardware counters; the others
+  // only pay for the countdown.
+  void samplePerf(Connection& connection) {
+    if (perf_counters_ == nullptr || perf_countdown_-- != 0) {
+      connection.timing.perf.arm(nullptr);
+      return;
+    }
+    perf_countdown_ = perf_interval_ - 1;
+    connection.timing.perf.arm(perf_counters_.get());
+  }
+
+  static uint64_t perfInterval(double rate) {
+    if (!perf_counters_compiled || rate <= 0) {
+      return 0;
+    }
+    return static_cast<uint64_t>(1 / std::min(rate, 1.0));
+  }
+
+  void exportTrace(const Connection& connection,
+                   RequestTiming::clock::time_point written) {
+    const auto& timing = connection.timing;
+    const auto offset = std::chrono::system_clock::now().time_since_epoch() -
+                        written.time_since_epoch();
+    const auto unix_ns = [offset](RequestTiming::clock::time_point time) {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 time.time_since_epoch() + offset)
+          .count();
+    };
+    const bool pushed = traces_->tryPush([&](TraceRecord& record) {
+      record.trace = *connection.trace;
+      for (auto& id : record.span_ids) {
+        sampler_.fill(id);
+      }
+      record.times = {unix_ns(timing.received), unix_ns(timing.parsed),
+                      unix_ns(timing.routed), unix_ns(timing.handled),
+                      unix_ns(written)};
+      record.route = timing.route;
+      record.status =
+          static_cast<uint16_t>(connection.output->response().status_code);
+    });
+    if (!pushed) {
+      metrics_.traces_dropped.add();
+    }
+  }
+
+  // Feeds the latency histograms and the flight recorder.
+  void recordLatency(const Connection& connection,
+                     RequestTiming::clock::time_point written) {
+    const auto& timing = connection.timing;
+    const std::array<std::chrono::nanoseconds, 4> phases{
+        timing.parsed - timing.received, timing.routed - timing.parsed,
+        timing.handled - timing.routed, written - timing.handled};
+    for (std::size_t phase = 0; phase < phases.size(); ++phase) {
+      metrics_.recordLatency(timing.route, static_cast<Phase>(phase),
+                             phases[phase]);
+    }
+    metrics_.recordLatency(timing.route, Phase::TOTAL,
+                           written - timing.received);
+
+    if (flight_ != nullptr) {
+      FlightRecord record{
+          .received_ns = timing.received.time_since_epoch().count(),
+          .route = static_cast<uint32_t>(timing.route),
+          .status =
+              static_cast<uint16_t>(connection.output->response().status_code),
+          .bytes = connection.output->bytesSent()};
+      for (std::size_t phase = 0; phase < phases.size(); ++phase) {
+        record.phase_ns[phase] = static_cast<uint64_t>(phases[phase].count());
+      }
+      flight_->record(record);
+    }
+  }
+
+  bool watch(ConnectionHandle handle, uint32_t events, int op) {
+    Connection* connection = connections_.get(handle);
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = handle.pack();
+    if (::epoll_ctl(epoll_fd_, op, connection->fd, &event) == -1) {
+      return false;
+    }
+    connection->events = events;
+    return true;
+  }
+
+  // The header timeout runs from the first byte of a request to the end of
+  // its head and is not extended by progress; the others restart on every
+  // read or write that makes progress.
+  void arm(Connection& connection, Deadline deadline) {
+    if (deadline == Deadline::HEADER &&
+        connection.deadline == Deadline::HEADER) {
+      return;
+    }
+
+    connection.deadline = deadline;
+    const auto timeout = timeoutFor(deadline);
+    if (timeout.count() > 0) {
+      timers_.schedule(connection.timer, timeout);
+    } else {
+      timers_.cancel(connection.timer);
+    }
+  }
+
+  [[nodiscard]] std::chrono::milliseconds timeoutFor(Deadline deadline) const {
+    switch (deadline) {
+      case Deadline::HEADER:
+        return config_.getHeaderTimeout();
+      case Deadline::BODY:
+        return config_.getBodyTimeout();
+      case Deadline::KEEP_ALIVE:
+        return config_.getKeepAliveTimeout();
+      case Deadline::WRITE:
+        return config_.getWriteTimeout();
+      case Deadline::LINGER:
+        return linger_timeout;
+      case Deadline::NONE:
+        break;
+    }
+    return std::chrono::milliseconds::zero();
+  }
+
+  void closeConnection(ConnectionHandle handle) {
+    if (Connection* connection = connections_.get(handle)) {
+      timers_.cancel(connection->timer);
+      if (connection->output) {
+        metrics_.bytes_sent.add(connection->output->bytesSent());
+      }
+      ::close(connection->fd);
+      connections_.release(handle);
+      metrics_.connections_active.add(-1);
+    }
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace httpxx {
+
+// An open, read-only file descriptor together with the fstat() taken when it
+// was opened. The descriptor is closed when the last reference goes away, so
+// a response that still holds one stays valid after the cache evicted it.
+class CachedFile {
+ public:
+  CachedFile(int fd, const struct stat& st) : fd_(fd), stat_(st) {}
+
+  CachedFile(const CachedFile&) = delete;
+  CachedFile& operator=(const CachedFile&) = delete;
+
+  ~CachedFile() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  [[nodiscard]] int fd() const { return fd_; }
+  [[nodiscard]] const struct stat& stat() const { return stat_; }
+  [[nodiscard]] std::size_t size() const {
+    return static_cast<std::size_t>(stat_.st_size);
+  }
+
+  [[nodiscard]] bool sameFileAs(const struct stat& st) const {
+    return st.st_dev == stat_.st_dev && st.st_ino == stat_.st_ino &&
+           st.st_size == stat_.st_size &&
+           st.st_mtim.tv_sec == stat_.st_mtim.tv_sec &&
+           st.st_mtim.tv_nsec == stat_.st_mtim.tv_nsec;
+  }
+
+ private:
+  int fd_{-1};
+  struct stat stat_{};
+};
+
+// Small LRU of open descriptors for hot static files. A hit inside the
+// revalidation interval costs no syscalls; after it a single stat() checks
+// that the file on disk is still the one we have open. Paths are spread by
+// hash over lock-striped shards, each an LRU with its share of the
+// capacity, so workers serving different files rarely contend for a lock.
+class FdCache {
+ public:
+  using clock = std::chrono::steady_clock;
+  using file_t = std::shared_ptr<const CachedFile>;
+
+  static constexpr std::size_t shard_count = 16;
+  static constexpr std::size_t default_capacity = 256;
+  static constexpr std::chrono::milliseconds default_revalidate_interval{1000};
+
+  explicit FdCache(std::size_t capacity = default_capacity,
+                   std::chrono::milliseconds revalidate_interval =
+                       default_revalidate_interval) {
+    setCapacity(capacity);
+    setRevalidateInterval(revalidate_interval);
+  }
+
+  static FdCache& global() {
+    static FdCache cache;
+    return cache;
+  }
+
+  // Returns nullptr when the path cannot be opened or is not a regular file.
+  [[nodiscard]] file_t open(const std::filesystem::path& path) {
+    const auto now = clock::now();
+    std::string key = path.string();
+    Shard& shard = shards_[std::hash<std::string>{}(key) % shard_count];
+
+    std::lock_guard lock(shard.mutex);
+    if (shard.capacity == 0) {
+      return openFile(key);
+    }
+
+    if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+      Entry& entry = it->second;
+      bool fresh = now - entry.validated_at < shard.revalidate_interval;
+      if (!fresh && stillValid(key, *entry.file)) {
+        entry.validated_at = now;
+        fresh = true;
+      }
+      if (fresh) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+        return entry.file;
+      }
+      shard.lru.erase(entry.lru);
+      shard.entries.erase(it);
+    }
+
+    auto file = openFile(key);
+    if (!file) {
+      return nullptr;
+    }
+
+    shard.lru.push_front(key);
+    shard.entries.emplace(std::move(key), Entry{file, now, shard.lru.begin()});
+    shard.evictOverflow();
+    return file;
+  }
+
+  // Split evenly over the shards, rounding up, so a capacity below
+  // shard_count still caches something.
+  void setCapacity(std::size_t capacity) {
+    const auto per_shard = (capacity + shard_count - 1) / shard_count;
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      shard.capacity = per_shard;
+      shard.evictOverflow();
+    }
+  }
+
+  void setRevalidateInterval(std::chrono::milliseconds interval) {
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      shard.revalidate_interval = interval;
+    }
+  }
+
+  void clear() {
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      shard.entries.clear();
+      shard.lru.clear();
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      total += shard.entries.size();
+    }
+    return total;
+  }
+
+ private:
+  struct Entry {
+    file_t file;
+    clock::time_point validated_at;
+    std::list<std::string>::iterator lru;
+  };
+
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;
+    std::size_t capacity{0};
+    std::chrono::milliseconds revalidate_interval{0};
+
+    void evictOverflow() {
+      while (entries.size() > capacity && !lru.empty()) {
+        entries.erase(lru.back());
+        lru.pop_back();
+      }
+    }
+  };
+
+  std::array<Shard, shard_count> shards_;
+
+  static file_t openFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return nullptr;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+      ::close(fd);
+      return nullptr;
+    }
+
+    return std::make_shared<const CachedFile>(fd, st);
+  }
+
+  static bool stillValid(const std::string& path, const CachedFile& file) {
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0 && file.sameFileAs(st);
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "httpxx/router.hh"
+
+namespace httpxx {
+
+// One answered request. received is a steady_clock reading in nanoseconds;
+// phases are the parse, route, handler and write durations.
+struct FlightRecord {
+  int64_t received_ns{0};
+  std::array<uint64_t, 4> phase_ns{};
+  uint32_t route{0};
+  uint16_t status{0};
+  uint64_t bytes{0};
+};
+
+// Always-on record of the last requests each worker answered, in fixed
+// memory: a ring per worker that overwrites its oldest entry. Dumps are meant
+// for looking at tail-latency outliers after the fact and list every
+// retained request, oldest first.
+class FlightRecorder {
+ public:
+  // Written by one worker, read by dumps from any thread. Each slot is a
+  // seqlock on its own cache line: the worker makes the sequence odd while it
+  // writes, and readers skip slots that changed while they read them.
+  class Ring {
+   public:
+    explicit Ring(std::size_t capacity) : slots_(capacity) {}
+
+    void record(const FlightRecord& entry) {
+      if (slots_.empty()) {
+        return;
+      }
+      auto& slot = slots_[next_];
+      next_ = next_ + 1 == slots_.size() ? 0 : next_ + 1;
+
+      const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+      slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      const auto words = pack(entry);
+      for (std::size_t i = 0; i < words.size(); ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+      }
+      slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    void collect(std::vector<FlightRecord>& out) const {
+      for (const auto& slot : slots_) {
+        const auto before = slot.sequence.load(std::memory_order_acquire);
+        if (before == 0 || (before & 1) != 0) {
+          continue;
+        }
+        Words words;
+        for (std::size_t i = 0; i < words.size(); ++i) {
+          words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+          out.push_back(unpack(words));
+        }
+      }
+    }
+
+   private:
+    using Words = std::array<uint64_t, 7>;
+
+    struct alignas(64) Slot {
+      std::atomic<uint64_t> sequence{0};
+      std::array<std::atomic<uint64_t>, 7> words{};
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t next_{0};
+
+    static Words pack(const FlightRecord& entry) {
+      return {static_cast<uint64_t>(entry.received_ns),
+              entry.phase_ns[0],
+              entry.phase_ns[1],
+              entry.phase_ns[2],
+              entry.phase_ns[3],
+              uint64_t{entry.route} << 16 | entry.status,
+              entry.bytes};
+    }
+
+    static FlightRecord unpack(const Words& words) {
+      return {.received_ns = static_cast<int64_t>(words[0]),
+              .phase_ns = {words[1], words[2], words[3], words[4]},
+              .route = static_cast<uint32_t>(words[5] >> 16),
+              .status = static_cast<uint16_t>(words[5]),
+              .bytes = words[6]};
+    }
+  };
+
+  explicit FlightRecorder(std::size_t per_worker) : per_worker_(per_worker) {}
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  void setRoutes(const Router& router) {
+    std::lock_guard lock(mutex_);
+    routes_.clear();
+    for (std::size_t id = 0; id <= router.static_route(); ++id) {
+      routes_.emplace_back(router.route_label(id));
+    }
+  }
+
+  [[nodiscard]] Ring& attach() {
+    std::lock_guard lock(mutex_);
+    rings_.push_back(std::make_unique<Ring>(per_worker_));
+    return *rings_.back();
+  }
+
+  // Tab-separated, one request per line after a header line. Times are
+  // Unix nanoseconds, durations nanoseconds.
+  [[nodiscard]] std::string dump() const {
+    std::vector<std::pair<std::size_t, FlightRecord>> entries;
+    std::vector<std::string> routes;
+    {
+      std::lock_guard lock(mutex_);
+      routes = routes_;
+      std::vector<FlightRecord> records;
+      for (std::size_t worker = 0; worker < rings_.size(); ++worker) {
+        records.clear();
+        rings_[worker]->collect(records);
+        for (const auto& record : records) {
+          entries.emplace_back(worker, record);
+        }
+      }
+    }
+    std::ranges::sort(entries, {}, [](const auto& entry) {
+      return entry.second.received_ns;
+    });
+
+    const auto offset =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch() -
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    std::string out =
+        "received_unix_ns\tworker\troute\tstatus\tbytes\tparse_ns\troute_ns\t"
+        "handler_ns\twrite_ns\ttotal_ns\n";
+    auto it = std::back_inserter(out);
+    for (const auto& [worker, record] : entries) {
+      const auto& phases = record.phase_ns;
+      fmt::format_to(it, "{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\n",
+                     record.received_ns + offset, worker,
+                     record.route < routes.size()
+                         ? std::string_view(routes[record.route])
+                         : std::string_view("unmatched"),
+                     record.status, record.bytes, phases[0], phases[1],
+                     phases[2], phases[3],
+                     phases[0] + phases[1] + phases[2] + phases[3]);
+    }
+    return out;
+  }
+
+  // Replaces path with a dump. Returns false when it cannot be written.
+  bool dumpTo(const std::filesystem::path& path) const {
+    const auto text = dump();
+    const int fd =
+        ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+      return false;
+    }
+    std::string_view pending(text);
+    while (!pending.empty()) {
+      const auto written = ::write(fd, pending.data(), pending.size());
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        ::close(fd);
+        return false;
+      }
+      pending.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return ::close(fd) == 0;
+  }
+
+ private:
+  std::size_t per_worker_;
+  mutable std::mutex mutex_;
+  std::vector<std::string> routes_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+}  // namespace httpxx
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace httpxx {
+
+// Passes listening sockets between an old and a new server process over an
+// AF_UNIX control socket, so a binary upgrade never leaves the port unbound:
+//
+//   1. the new process connects to the control socket of the running one
+//      and receives its listening descriptors via SCM_RIGHTS (takeOver());
+//   2. it starts accepting on them, then sends a one byte acknowledgement
+//      and binds the control socket itself (ready());
+//   3. on the acknowledgement the old process drains and exits
+//      (finishHandOver() returns true).
+//
+// If nobody listens on the control socket, takeOver() returns nullopt and
+// the caller binds as usual.
+class ListenerHandoff {
+ public:
+  static constexpr std::size_t max_descriptors = 16;
+  static constexpr std::chrono::milliseconds ack_timeout{5000};
+
+  explicit ListenerHandoff(std::filesystem::path path)
+      : path_(std::move(path)) {}
+
+  ListenerHandoff(const ListenerHandoff&) = delete;
+  ListenerHandoff& operator=(const ListenerHandoff&) = delete;
+
+  ~ListenerHandoff() {
+    if (peer_fd_ != -1) ::close(peer_fd_);
+    if (pending_fd_ != -1) ::close(pending_fd_);
+    if (control_fd_ != -1) {
+      ::close(control_fd_);
+      // Leave the path alone if a newer process has already rebound it.
+      struct stat st{};
+      if (::stat(path_.c_str(), &st) == 0 && st.st_ino == control_inode_) {
+        ::unlink(path_.c_str());
+      }
+    }
+  }
+
+  // Asks a running server for its listening sockets.
+  std::optional<std::vector<int>> takeOver() {
+    const int fd = connectTo(path_);
+    if (fd == -1) {
+      return std::nullopt;
+    }
+
+    auto fds = receiveDescriptors(fd);
+    if (fds.empty()) {
+      ::close(fd);
+      throw std::runtime_error(fmt::format(
+          "[httpx::ListenerHandoff] No listener received from '{}'",
+          path_.string()));
+    }
+    peer_fd_ = fd;
+    return fds;
+  }
+
+  // Call once the taken-over sockets are being accepted on: releases the
+  // previous process and starts serving handoff requests ourselves.
+  void ready() {
+    if (peer_fd_ != -1) {
+      const char ack = 'R';
+      [[maybe_unused]] auto _ = ::write(peer_fd_, &ack, 1);
+      ::close(peer_fd_);
+      peer_fd_ = -1;
+    }
+    bindControlSocket();
+  }
+
+  // Descriptor to watch for incoming handoff requests, -1 before ready().
+  [[nodiscard]] int controlFd() const { return control_fd_; }
+
+  // Sends the listening sockets to a process waiting on the control socket.
+  // Returns the descriptor its acknowledgement arrives on, to be watched
+  // until it is readable and then passed to finishHandOver(), or -1. Never
+  // blocks, so the caller keeps serving meanwhile. A new offer replaces one
+  // still waiting for its acknowledgement.
+  int offer(std::span<const int> listeners) {
+    const int peer = ::accept4(control_fd_, nullptr, nullptr,
+                               SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (peer == -1) {
+      return -1;
+    }
+    if (!sendDescriptors(peer, listeners)) {
+      ::close(peer);
+      std::clog << "Listener handoff failed, keeping the listener\n";
+      return -1;
+    }
+    if (pending_fd_ != -1) {
+      ::close(pending_fd_);
+    }
+    pending_fd_ = peer;
+    return peer;
+  }
+
+  // Reads the acknowledgement of the pending offer. Returns true if the new
+  // process took over, i.e. this one should drain.
+  bool finishHandOver() {
+    char ack = 0;
+    const bool acknowledged = pending_fd_ != -1 &&
+                              ::read(pending_fd_, &ack, 1) == 1 && ack == 'R';
+    closePending(acknowledged);
+    return acknowledged;
+  }
+
+  // Gives up on the pending offer once ack_timeout has passed.
+  void abandonHandOver() { closePending(false); }
+
+  // Listening sockets passed by systemd-style socket activation (LISTEN_FDS,
+  // starting at descriptor 3). The variables are cleared so child processes
+  // do not inherit them.
+  static std::vector<int> fromEnvironment() {
+    constexpr int first_fd = 3;
+
+    const char* pid = std::getenv("LISTEN_PID");
+    const char* count = std::getenv("LISTEN_FDS");
+    if (pid == nullptr || count == nullptr ||
+        parseNumber(pid) != static_cast<long>(::getpid())) {
+      return {};
+    }
+
+    const auto n = parseNumber(count);
+    if (!n || *n < 0 || *n > static_cast<long>(max_descriptors)) {
+      throw std::runtime_error(fmt::format(
+          "[httpx::ListenerHandoff] Invalid LISTEN_FDS '{}'", count));
+    }
+    std::vector<int> fds;
+    for (int fd = first_fd; fd < first_fd + *n; ++fd) {
+      ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fds.push_back(fd);
+    }
+
+    ::unsetenv("LISTEN_PID");
+    ::unsetenv("LISTEN_FDS");
+    ::unsetenv("LISTEN_FDNAMES");
+    return fds;
+  }
+
+ private:
+  std::filesystem::path path_;
+  int peer_fd_{-1};
+  int control_fd_{-1};
+  int pending_fd_{-1};
+  ino_t control_inode_{0};
+
+  void closePending(bool acknowledged) {
+    if (pending_fd_ == -1) {
+      return;
+    }
+    ::close(pending_fd_);
+    pending_fd_ = -1;
+    std::clog << (acknowledged
+                      ? "Listening socket handed over, draining\n"
+                      : "Listener handoff failed, keeping the listener\n");
+  }
+
+  static std::optional<long> parseNumber(std::string_view text) {
+    long value = 0;
+    const auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  static sockaddr_un address(const std::filesystem::path& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.native().size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error(fmt::format(
+          "[httpx::ListenerHandoff] Socket path '{}' is too long",
+          path.string()));
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.native().size());
+    return addr;
+  }
+
+  static int connectTo(const std::filesystem::path& path) {
+    const auto addr = address(path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+      return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr),
+                  sizeof(addr)) == -1) {
+      ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  void bindControlSocket() {
+    const auto addr = address(path_);
+    control_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                           0);
+    ::unlink(path_.c_str());
+    struct stat st{};
+    if (control_fd_ == -1 ||
+        ::bind(control_fd_, reinterpret_cast<const sockaddr*>(&addr),
+               sizeof(addr)) == -1 ||
+        ::listen(control_fd_, 1) == -1 || ::stat(path_.c_str(), &st) == -1) {
+      throw std::runtime_error(fmt::format(
+          "[httpx::ListenerHandoff] Cannot listen on '{}': {}",
+          path_.string(), std::strerror(errno)));
+    }
+    control_inode_ = st.st_ino;
+  }
+
+  static bool sendDescriptors(int peer, std::span<const int> fds) {
+    if (fds.empty() || fds.size() > max_descriptors) {
+      return false;
+    }
+
+    char tag = 'L';
+    iovec iov{&tag, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * max_descriptors)]{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    return ::sendmsg(peer, &msg, MSG_NOSIGNAL) == 1;
+  }
+
+  static std::vector<int> receiveDescriptors(int peer) {
+    char tag = 0;
+    iovec iov{&tag, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * max_descriptors)]{};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    std::vector<int> fds;
+    if (::recvmsg(peer, &msg, MSG_CMSG_CLOEXEC) != 1 || tag != 'L') {
+      return fds;
+    }
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        continue;
+      }
+      const auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      fds.resize(fds.size() + count);
+      std::memcpy(fds.data() + fds.size() - count, CMSG_DATA(cmsg),
+                  count * sizeof(int));
+    }
+    return fds;
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "httpxx/perfect_hash.hh"
+
+namespace httpxx {
+
+enum class HeaderId : uint8_t {
+  OTHER = 0,
+  ACCEPT,
+  ACCEPT_ENCODING,
+  ACCEPT_LANGUAGE,
+  AUTHORIZATION,
+  CACHE_CONTROL,
+  CONNECTION,
+  CONTENT_ENCODING,
+  CONTENT_LENGTH,
+  CONTENT_TYPE,
+  COOKIE,
+  DATE,
+  ETAG,
+  EXPECT,
+  HOST,
+  IF_MODIFIED_SINCE,
+  IF_NONE_MATCH,
+  KEEP_ALIVE,
+  LAST_MODIFIED,
+  LOCATION,
+  ORIGIN,
+  RANGE,
+  REFERER,
+  RETRY_AFTER,
+  SERVER,
+  SET_COOKIE,
+  TRANSFER_ENCODING,
+  UPGRADE,
+  USER_AGENT,
+  VARY,
+  X_FORWARDED_FOR,
+  header_id_count
+};
+
+inline constexpr std::array<std::string_view,
+                            static_cast<std::size_t>(HeaderId::header_id_count)>
+    header_names{
+        "",
+        "Accept",
+        "Accept-Encoding",
+        "Accept-Language",
+        "Authorization",
+        "Cache-Control",
+        "Connection",
+        "Content-Encoding",
+        "Content-Length",
+        "Content-Type",
+        "Cookie",
+        "Date",
+        "ETag",
+        "Expect",
+        "Host",
+        "If-Modified-Since",
+        "If-None-Match",
+        "Keep-Alive",
+        "Last-Modified",
+        "Location",
+        "Origin",
+        "Range",
+        "Referer",
+        "Retry-After",
+        "Server",
+        "Set-Cookie",
+        "Transfer-Encoding",
+        "Upgrade",
+        "User-Agent",
+        "Vary",
+        "X-Forwarded-For",
+    };
+
+inline constexpr auto header_ids_by_name = []() consteval {
+  constexpr std::size_t count = header_names.size() - 1;
+  std::array<std::pair<std::string_view, HeaderId>, count> entries{};
+  for (std::size_t i = 0; i < count; ++i) {
+    entries[i] = {header_names[i + 1], static_cast<HeaderId>(i + 1)};
+  }
+  return PerfectHashMap<HeaderId, count, true>(entries);
+}();
+
+inline constexpr HeaderId headerIdFromName(std::string_view name) {
+  const HeaderId* found = header_ids_by_name.find(name);
+  return found != nullptr ? *found : HeaderId::OTHER;
+}
+
+inline constexpr std::string_view headerName(HeaderId id) {
+  return header_names[static_cast<std::size_t>(id)];
+}
+
+// Header fields in insertion order. Names and values are packed into one
+// byte buffer and the first inline_capacity fields live inside the object,
+// so a typical request or response allocates at most once for its headers.
+// Names compare case-insensitively; well-known names are matched by id.
+class Headers {
+  struct Field {
+    HeaderId id;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t value_offset;
+    uint32_t value_length;
+  };
+
+ public:
+  static constexpr std::size_t inline_capacity = 16;
+  static constexpr std::size_t initial_bytes = 512;
+
+  using value_type = std::pair<std::string_view, std::string_view>;
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Headers::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    const_iterator() = default;
+    const_iterator(const Headers* headers, const Field* field)
+        : headers_(headers), field_(field) {}
+
+    value_type operator*() const {
+      return {headers_->nameOf(*field_), headers_->valueOf(*field_)};
+    }
+    const_iterator& operator++() {
+      ++field_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto copy = *this;
+      ++field_;
+      return copy;
+    }
+    bool operator==(const const_iterator& other) const {
+      return field_ == other.field_;
+    }
+
+   private:
+    const Headers* headers_{nullptr};
+    const Field* field_{nullptr};
+  };
+
+  Headers() = default;
+
+  explicit Headers(allocator_type alloc) : spill_(alloc), bytes_(alloc) {}
+
+  Headers(const Headers& other, allocator_type alloc)
+      : inline_(other.inline_),
+        spill_(other.spill_, alloc),
+        count_(other.count_),
+        bytes_(other.bytes_, alloc) {}
+
+  Headers(std::initializer_list<value_type> fields) {
+    for (const auto& [name, value] : fields) {
+      add(name, value);
+    }
+  }
+
+  [[nodiscard]] std::optional<std::string_view> get(HeaderId id) const {
+    const Field* field = find(id, {});
+    return field ? std::optional(valueOf(*field)) : std::nullopt;
+  }
+
+  [[nodiscard]] std::optional<std::string_view> get(
+      std::string_view name) const {
+    const Field* field = find(headerIdFromName(name), name);
+    return field ? std::optional(valueOf(*field)) : std::nullopt;
+  }
+
+  [[nodiscard]] bool contains(HeaderId id) const {
+    return find(id, {}) != nullptr;
+  }
+
+  [[nodiscard]] bool contains(std::string_view name) const {
+    return find(headerIdFromName(name), name) != nullptr;
+  }
+
+  // Appends a field even if one with the same name exists (e.g. Set-Cookie).
+  void add(std::string_view name, std::string_view value) {
+    const HeaderId id = headerIdFromName(name);
+    Field field{id, 0, 0, 0, 0};
+    if (id == HeaderId::OTHER) {
+      field.name_offset = append(name);
+      field.name_length = static_cast<uint32_t>(name.size());
+    }
+    field.value_offset = append(value);
+    field.value_length = static_cast<uint32_t>(value.size());
+    push(field);
+  }
+
+  void add(HeaderId id, std::string_view value) {
+    add(headerName(id), value);
+  }
+
+  // Replaces the value of the first field with this name, or appends one.
+  void set(std::string_view name, std::string_view value) {
+    if (Field* field = findMutable(headerIdFromName(name), name)) {
+      field->value_offset = append(value);
+      field->value_length = static_cast<uint32_t>(value.size());
+      return;
+    }
+    add(name, value);
+  }
+
+  void set(HeaderId id, std::string_view value) { set(headerName(id), value); }
+
+  bool erase(std::string_view name) {
+    Field* field = findMutable(headerIdFromName(name), name);
+    if (field == nullptr) {
+      return false;
+    }
+
+    auto all = fields();
+    std::move(field + 1, all.data() + all.size(), field);
+    if (!spill_.empty()) {
+      spill_.pop_back();
+    }
+    --count_;
+    return true;
+  }
+
+  void clear() {
+    bytes_.clear();
+    spill_.clear();
+    count_ = 0;
+  }
+
+  void reserve(std::size_t bytes) { bytes_.reserve(bytes); }
+
+  [[nodiscard]] std::size_t size() const { return count_; }
+  [[nodiscard]] bool empty() const { return count_ == 0; }
+
+  [[nodiscard]] const_iterator begin() const {
+    return {this, fields().data()};
+  }
+  [[nodiscard]] const_iterator end() const {
+    return {this, fields().data() + fields().size()};
+  }
+
+ private:
+  std::array<Field, inline_capacity> inline_{};
+  std::pmr::vector<Field> spill_{};
+  uint32_t count_{0};
+  std::pmr::string bytes_{};
+
+  [[nodiscard]] std::span<const Field> fields() const {
+    return spill_.empty() ? std::span<const Field>(inline_.data(), count_)
+                          : std::span<const Field>(spill_);
+  }
+
+  [[nodiscard]] std::span<Field> fields() {
+    return spill_.empty() ? std::span<Field>(inline_.data(), count_)
+                          : std::span<Field>(spill_);
+  }
+
+  [[nodiscard]] std::string_view nameOf(const Field& field) const {
+    if (field.id != HeaderId::OTHER) {
+      return headerName(field.id);
+    }
+    return {bytes_.data() + field.name_offset, field.name_length};
+  }
+
+  [[nodiscard]] std::string_view valueOf(const Field& field) const {
+    return {bytes_.data() + field.value_offset, field.value_length};
+  }
+
+  uint32_t append(std::string_view text) {
+    if (bytes_.capacity() < initial_bytes) {
+      bytes_.reserve(initial_bytes);
+    }
+    const auto offset = static_cast<uint32_t>(bytes_.size());
+    bytes_.append(text);
+    return offset;
+  }
+
+  void push(const Field& field) {
+    if (spill_.empty() && count_ < inline_capacity) {
+      inline_[count_++] = field;
+      return;
+    }
+    if (spill_.empty()) {
+      spill_.assign(inline_.begin(), inline_.begin() + count_);
+    }
+    spill_.push_back(field);
+    count_ = static_cast<uint32_t>(spill_.size());
+  }
+
+  static bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+      auto a = static_cast<unsigned char>(lhs[i]);
+      auto b = static_cast<unsigned char>(rhs[i]);
+      if (a >= 'A' && a <= 'Z') a |= 0x20;
+      if (b >= 'A' && b <= 'Z') b |= 0x20;
+      if (a != b) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  [[nodiscard]] const Field* find(HeaderId id, std::string_view name) const {
+    for (const Field& field : fields()) {
+      if (field.id != id) continue;
+      if (id != HeaderId::OTHER || equalsIgnoreCase(nameOf(field), name)) {
+        return &field;
+      }
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] Field* findMutable(HeaderId id, std::string_view name) {
+    return const_cast<Field*>(std::as_const(*this).find(id, name));
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace httpxx {
+
+// Log-linear latency buckets in the style of HdrHistogram: every power of two
+// is split into 16 linear sub-buckets, so a recorded value is off by at most
+// 1/16 (about 6%) whatever its magnitude. Durations are recorded in
+// nanoseconds up to about 68 seconds; longer ones land in the last bucket.
+struct HistogramBuckets {
+  static constexpr unsigned sub_bucket_bits = 4;
+  static constexpr uint64_t sub_buckets = uint64_t{1} << sub_bucket_bits;
+  static constexpr unsigned max_exponent = 36;
+  static constexpr std::size_t count =
+      (max_exponent - sub_bucket_bits + 1) * sub_buckets;
+
+  static constexpr std::size_t index(uint64_t value) {
+    if (value < sub_buckets) {
+      return static_cast<std::size_t>(value);
+    }
+    const auto exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+    if (exponent >= max_exponent) {
+      return count - 1;
+    }
+    const auto shift = exponent - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + ((value >> shift) & (sub_buckets - 1));
+  }
+
+  // The largest value that falls into bucket i.
+  static constexpr uint64_t highest(std::size_t i) {
+    if (i < sub_buckets) {
+      return i;
+    }
+    const auto shift = i / sub_buckets - 1;
+    const auto lowest = (sub_buckets + i % sub_buckets) << shift;
+    return lowest + (uint64_t{1} << shift) - 1;
+  }
+};
+
+static_assert(HistogramBuckets::index(HistogramBuckets::highest(100)) == 100);
+static_assert(HistogramBuckets::index(31) == 31);
+
+// Merged, non-atomic copy of one or more histograms.
+class HistogramSnapshot {
+ public:
+  void add(std::size_t bucket, uint64_t count) { counts_[bucket] += count; }
+
+  void addSum(uint64_t nanoseconds) { sum_ += nanoseconds; }
+
+  [[nodiscard]] uint64_t bucketCount(std::size_t bucket) const {
+    return counts_[bucket];
+  }
+
+  [[nodiscard]] uint64_t count() const {
+    uint64_t total = 0;
+    for (const auto count : counts_) {
+      total += count;
+    }
+    return total;
+  }
+
+  [[nodiscard]] std::chrono::nanoseconds sum() const {
+    return std::chrono::nanoseconds(sum_);
+  }
+
+  // The value below which a fraction q of the recorded values fall, rounded
+  // up to the end of its bucket. Zero when nothing was recorded.
+  [[nodiscard]] std::chrono::nanoseconds percentile(double q) const {
+    const auto total = count();
+    if (total == 0) {
+      return std::chrono::nanoseconds(0);
+    }
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::chrono::nanoseconds(HistogramBuckets::highest(i));
+      }
+    }
+    return std::chrono::nanoseconds(
+        HistogramBuckets::highest(counts_.size() - 1));
+  }
+
+ private:
+  std::array<uint64_t, HistogramBuckets::count> counts_{};
+  uint64_t sum_{0};
+};
+
+// Histogram with a single writer. Like the counters in metrics.hh, recording
+// is a relaxed load and store per bucket, and readers copy it out with
+// snapshotInto() whenever they like.
+class Histogram {
+ public:
+  void record(std::chrono::nanoseconds duration) {
+    const auto value = static_cast<uint64_t>(std::max<int64_t>(
+        0, static_cast<int64_t>(duration.count())));
+    bump(counts_[HistogramBuckets::index(value)], 1);
+    bump(sum_, value);
+  }
+
+  void snapshotInto(HistogramSnapshot& snapshot) const {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      if (const auto count = counts_[i].load(std::memory_order_relaxed)) {
+        snapshot.add(i, count);
+      }
+    }
+    snapshot.addSum(sum_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, HistogramBuckets::count> counts_{};
+  std::atomic<uint64_t> sum_{0};
+
+  static void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+  }
+};
+
+}  // namespace httpxx
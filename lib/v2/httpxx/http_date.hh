@@ -0,0 +1,92 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <string_view>
+
+namespace httpxx {
+
+// Preformatted "Date: <IMF-fixdate>\r\n" line, so responses can copy it
+// instead of formatting a time. The first caller in a new second rewrites it;
+// there is no timer thread, so a process that merely builds a Response does
+// not get one.
+class DateCache {
+ public:
+  static constexpr std::size_t line_length =
+      sizeof("Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n") - 1;
+
+  static DateCache& global() {
+    static DateCache cache;
+    return cache;
+  }
+
+  DateCache(const DateCache&) = delete;
+  DateCache& operator=(const DateCache&) = delete;
+
+  // The returned view stays valid for a few seconds; copy it right away.
+  [[nodiscard]] std::string_view line() {
+    const auto now = std::time(nullptr);
+    if (now != second_.load(std::memory_order_acquire)) {
+      refresh(now);
+    }
+    const auto& slot = slots_[current_.load(std::memory_order_acquire)];
+    return {slot.data(), line_length};
+  }
+
+  [[nodiscard]] std::string_view value() {
+    auto date = line();
+    date.remove_prefix(sizeof("Date: ") - 1);
+    date.remove_suffix(sizeof("\r\n") - 1);
+    return date;
+  }
+
+ private:
+  static constexpr std::size_t slot_count = 4;
+
+  std::array<std::array<char, line_length + 1>, slot_count> slots_{};
+  std::atomic<std::size_t> current_{0};
+  std::atomic<std::time_t> second_{0};
+  std::mutex mutex_;
+
+  DateCache() {
+    const auto now = std::time(nullptr);
+    format(0, now);
+    second_.store(now, std::memory_order_release);
+  }
+
+  // Writes the next slot, which readers left at least a second ago. Callers
+  // that lose the race keep using the line of the second before.
+  void refresh(std::time_t now) {
+    std::unique_lock lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || second_.load(std::memory_order_relaxed) == now) {
+      return;
+    }
+    const auto next =
+        (current_.load(std::memory_order_relaxed) + 1) % slot_count;
+    format(next, now);
+    current_.store(next, std::memory_order_release);
+    second_.store(now, std::memory_order_release);
+  }
+
+  void format(std::size_t slot, std::time_t now) {
+    static constexpr std::array<std::string_view, 7> days{
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static constexpr std::array<std::string_view, 12> months{
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    std::tm tm{};
+    gmtime_r(&now, &tm);
+    fmt::format_to_n(slots_[slot].data(), line_length,
+                     "Date: {}, {:02} {} {:04} {:02}:{:02}:{:02} GMT\r\n",
+                     days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon],
+                     tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+  }
+};
+
+}  // namespace httpxx
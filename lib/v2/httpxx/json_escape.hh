@@ -0,0 +1,29 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <iterator>
+#include <string_view>
+
+namespace httpxx {
+
+// Appends text to out as the inside of a JSON string. Quotes, backslashes,
+// control characters and DEL are escaped, so that client-supplied text can
+// neither end the string nor forge a line in a log of one record per line.
+// Out is a std::string or fmt::memory_buffer.
+template <typename Out>
+void appendJsonEscaped(Out& out, std::string_view text) {
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+      fmt::format_to(std::back_inserter(out), "\\u{:04x}",
+                     static_cast<int>(static_cast<unsigned char>(c)));
+    } else {
+      out.push_back(c);
+    }
+  }
+}
+
+}  // namespace httpxx
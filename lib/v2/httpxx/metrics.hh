@@ -0,0 +1,367 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "httpxx/histogram.hh"
+#include "httpxx/perf_counters.hh"
+#include "httpxx/router.hh"
+
+namespace httpxx {
+
+// A value with a single writer, one worker, and any number of readers. The
+// writer does a relaxed load and store rather than a locked read-modify-write,
+// so counting costs the same as incrementing a plain integer.
+template <typename T>
+class WorkerValue {
+ public:
+  void add(T amount = 1) {
+    value_.store(value_.load(std::memory_order_relaxed) + amount,
+                 std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] T value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<T> value_{0};
+};
+
+using Counter = WorkerValue<uint64_t>;
+using Gauge = WorkerValue<int64_t>;
+
+// Where a request spent its time: parsing, routing and middleware, the
+// handler, and writing the response. TOTAL runs from the complete request
+// to the last byte written.
+enum class Phase : uint8_t { PARSE, ROUTE, HANDLER, WRITE, TOTAL };
+
+inline constexpr std::size_t phase_count = 5;
+inline constexpr std::array<std::string_view, phase_count> phase_names{
+    "parse", "route", "handler", "write", "total"};
+
+// Latency of the requests answered by one route, merged over all workers.
+// counters sums the hardware counters of the requests sampled for them, see
+// Config::getPerfCounterSampleRate().
+struct RouteStats {
+  std::string route;
+  std::array<HistogramSnapshot, phase_count> phases{};
+  uint64_t counter_samples{0};
+  std::array<CounterValues, phase_count> counters{};
+
+  [[nodiscard]] const HistogramSnapshot& phase(Phase phase) const {
+    return phases[static_cast<std::size_t>(phase)];
+  }
+
+  // Mean count per sampled request, 0 without samples.
+  [[nodiscard]] double averageCounter(Phase phase,
+                                      HardwareCounter counter) const {
+    if (counter_samples == 0) {
+      return 0;
+    }
+    return static_cast<double>(counters[static_cast<std::size_t>(phase)]
+                                       [static_cast<std::size_t>(counter)]) /
+           static_cast<double>(counter_samples);
+  }
+};
+
+// The counters of one worker. Each worker has its own block, aligned so no
+// two workers write to the same cache line.
+struct alignas(64) WorkerMetrics {
+  static constexpr std::size_t status_classes = 5;
+
+  struct alignas(64) RouteCounters {
+    std::array<Counter, status_classes> by_class{};
+  };
+
+  struct RouteLatency {
+    std::array<Histogram, phase_count> by_phase{};
+  };
+
+  struct RouteHardware {
+    Counter samples;
+    std::array<std::array<Counter, hardware_counter_count>, phase_count>
+        by_phase{};
+  };
+
+  Counter connections_accepted;
+  Gauge connections_active;
+  Counter bytes_received;
+  Counter bytes_sent;
+  Counter requests_shed;
+  Counter requests_rate_limited;
+  Counter access_log_dropped;
+  Counter traces_dropped;
+  std::vector<RouteCounters> requests;
+  std::vector<RouteLatency> latency;
+  std::vector<RouteHardware> hardware;
+
+  explicit WorkerMetrics(std::size_t routes)
+      : requests(routes),
+        latency(routes),
+        hardware(perf_counters_compiled ? routes : 0) {}
+
+  void countRequest(std::size_t route, StatusCodes status) {
+    const auto code = static_cast<std::size_t>(status);
+    if (route < requests.size() && code >= 100 && code < 600) {
+      requests[route].by_class[code / 100 - 1].add();
+    }
+  }
+
+  void recordLatency(std::size_t route, Phase phase,
+                     std::chrono::nanoseconds duration) {
+    if (route < latency.size()) {
+      latency[route].by_phase[static_cast<std::size_t>(phase)].record(
+          duration);
+    }
+  }
+
+  void recordCounters(std::size_t route, const PerfSample& sample) {
+    if (!sample.active() || route >= hardware.size()) {
+      return;
+    }
+    auto& totals = hardware[route];
+    totals.samples.add();
+    for (std::size_t p = 0; p < phase_count; ++p) {
+      const auto counts = sample.phase(p);
+      for (std::size_t c = 0; c < hardware_counter_count; ++c) {
+        totals.by_phase[p][c].add(counts[c]);
+      }
+    }
+  }
+};
+
+// Registry of every worker's counters. Nothing is shared on the hot path;
+// render() sums the workers' blocks at scrape time into the Prometheus text
+// exposition format. Blocks outlive their workers, so totals survive
+// restarts of the event loops.
+class Metrics {
+ public:
+  Metrics() = default;
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+
+  // Labels requests by the router's paths, see Router::route_id(). Call
+  // before any worker is added.
+  void setRoutes(const Router& router) {
+    std::lock_guard lock(mutex_);
+    routes_.clear();
+    for (std::size_t id = 0; id <= router.static_route(); ++id) {
+      routes_.emplace_back(router.route_label(id));
+    }
+  }
+
+  [[nodiscard]] WorkerMetrics& addWorker() {
+    std::lock_guard lock(mutex_);
+    workers_.push_back(std::make_unique<WorkerMetrics>(routes_.size()));
+    return *workers_.back();
+  }
+
+  // Latency percentiles per route; routes sharing a path are merged.
+  [[nodiscard]] std::vector<RouteStats> stats() const {
+    std::lock_guard lock(mutex_);
+    return collectStats();
+  }
+
+  [[nodiscard]] std::string render() const {
+    std::lock_guard lock(mutex_);
+    std::string out;
+    auto it = std::back_inserter(out);
+
+    const auto sum = [this](auto member) {
+      int64_t total = 0;
+      for (const auto& worker : workers_) {
+        total += static_cast<int64_t>(((*worker).*member).value());
+      }
+      return total;
+    };
+    const auto scalar = [&](std::string_view name, std::string_view type,
+                            std::string_view help, int64_t value) {
+      fmt::format_to(it, "# HELP {0} {1}\n# TYPE {0} {2}\n{0} {3}\n", name,
+                     help, type, value);
+    };
+
+    scalar("httpxx_connections_accepted_total", "counter",
+           "Connections accepted.",
+           sum(&WorkerMetrics::connections_accepted));
+    scalar("httpxx_connections_active", "gauge", "Connections currently open.",
+           sum(&WorkerMetrics::connections_active));
+    scalar("httpxx_received_bytes_total", "counter",
+           "Bytes read from clients.", sum(&WorkerMetrics::bytes_received));
+    scalar("httpxx_sent_bytes_total", "counter", "Bytes written to clients.",
+           sum(&WorkerMetrics::bytes_sent));
+    scalar("httpxx_requests_shed_total", "counter",
+           "Requests answered with 503 by load shedding.",
+           sum(&WorkerMetrics::requests_shed));
+    scalar("httpxx_requests_rate_limited_total", "counter",
+           "Requests answered with 429 by the rate limiter.",
+           sum(&WorkerMetrics::requests_rate_limited));
+    scalar("httpxx_access_log_dropped_total", "counter",
+           "Access log records dropped because the logger fell behind.",
+           sum(&WorkerMetrics::access_log_dropped));
+    scalar("httpxx_traces_dropped_total", "counter",
+           "Sampled traces dropped because the exporter fell behind.",
+           sum(&WorkerMetrics::traces_dropped));
+
+    // Several endpoints can share a path, one per method.
+    std::map<std::string_view,
+             std::array<uint64_t, WorkerMetrics::status_classes>>
+        by_route;
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+      auto& totals = by_route[routes_[route]];
+      for (const auto& worker : workers_) {
+        for (std::size_t c = 0; c < WorkerMetrics::status_classes; ++c) {
+          totals[c] += worker->requests[route].by_class[c].value();
+        }
+      }
+    }
+
+    fmt::format_to(it,
+                   "# HELP httpxx_requests_total Requests answered, by route "
+                   "and status class.\n# TYPE httpxx_requests_total counter\n");
+    for (const auto& [route, totals] : by_route) {
+      for (std::size_t c = 0; c < WorkerMetrics::status_classes; ++c) {
+        if (totals[c] != 0) {
+          fmt::format_to(it,
+                         "httpxx_requests_total{{route=\"{}\",code=\"{}xx\"}} "
+                         "{}\n",
+                         escapeLabel(route), c + 1, totals[c]);
+        }
+      }
+    }
+
+    fmt::format_to(it,
+                   "# HELP httpxx_request_duration_seconds Request latency, "
+                   "by route and phase.\n"
+                   "# TYPE httpxx_request_duration_seconds summary\n");
+    for (const auto& route : collectStats()) {
+      const auto label = escapeLabel(route.route);
+      for (std::size_t p = 0; p < phase_count; ++p) {
+        const auto& histogram = route.phases[p];
+        const auto count = histogram.count();
+        if (count == 0) {
+          continue;
+        }
+        const auto labels =
+            fmt::format(R"(route="{}",phase="{}")", label, phase_names[p]);
+        for (const double q : {0.5, 0.99, 0.999}) {
+          fmt::format_to(it,
+                         "httpxx_request_duration_seconds{{{},quantile=\"{}\"}}"
+                         " {}\n",
+                         labels, q, seconds(histogram.percentile(q)));
+        }
+        fmt::format_to(it,
+                       "httpxx_request_duration_seconds_sum{{{}}} {}\n"
+                       "httpxx_request_duration_seconds_count{{{}}} {}\n",
+                       labels, seconds(histogram.sum()), labels, count);
+      }
+    }
+
+    if (perf_counters_compiled) {
+      renderCounters(it);
+    }
+    return out;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::string> routes_{"unmatched", "static"};
+  std::vector<std::unique_ptr<WorkerMetrics>> workers_;
+
+  [[nodiscard]] std::vector<RouteStats> collectStats() const {
+    std::vector<RouteStats> merged;
+    std::map<std::string_view, std::size_t> by_label;
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+      const auto [entry, added] =
+          by_label.try_emplace(routes_[route], merged.size());
+      if (added) {
+        merged.push_back({.route = routes_[route]});
+      }
+      auto& stats = merged[entry->second];
+      for (const auto& worker : workers_) {
+        for (std::size_t p = 0; p < phase_count; ++p) {
+          worker->latency[route].by_phase[p].snapshotInto(stats.phases[p]);
+        }
+        if (route < worker->hardware.size()) {
+          const auto& hardware = worker->hardware[route];
+          stats.counter_samples += hardware.samples.value();
+          for (std::size_t p = 0; p < phase_count; ++p) {
+            for (std::size_t c = 0; c < hardware_counter_count; ++c) {
+              stats.counters[p][c] += hardware.by_phase[p][c].value();
+            }
+          }
+        }
+      }
+    }
+    return merged;
+  }
+
+  void renderCounters(std::back_insert_iterator<std::string> it) const {
+    const auto stats = collectStats();
+    fmt::format_to(it,
+                   "# HELP httpxx_perf_sampled_requests_total Requests whose "
+                   "hardware counters were read, by route.\n"
+                   "# TYPE httpxx_perf_sampled_requests_total counter\n");
+    for (const auto& route : stats) {
+      if (route.counter_samples != 0) {
+        fmt::format_to(it,
+                       "httpxx_perf_sampled_requests_total{{route=\"{}\"}} "
+                       "{}\n",
+                       escapeLabel(route.route), route.counter_samples);
+      }
+    }
+    fmt::format_to(it,
+                   "# HELP httpxx_perf_events_total Hardware events counted "
+                   "in sampled requests, by route, phase and counter.\n"
+                   "# TYPE httpxx_perf_events_total counter\n");
+    for (const auto& route : stats) {
+      if (route.counter_samples == 0) {
+        continue;
+      }
+      const auto label = escapeLabel(route.route);
+      for (std::size_t p = 0; p < phase_count; ++p) {
+        for (std::size_t c = 0; c < hardware_counter_count; ++c) {
+          fmt::format_to(it,
+                         "httpxx_perf_events_total{{route=\"{}\",phase="
+                         "\"{}\",counter=\"{}\"}} {}\n",
+                         label, phase_names[p], hardware_counter_names[c],
+                         route.counters[p][c]);
+        }
+      }
+    }
+  }
+
+  static double seconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double>(duration).count();
+  }
+
+  static std::string escapeLabel(std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value) {
+      if (c == '\n') {
+        escaped.append("\\n");
+        continue;
+      }
+      if (c == '\\' || c == '"') {
+        escaped.push_back('\\');
+      }
+      escaped.push_back(c);
+    }
+    return escaped;
+  }
+};
+
+}  // namespace httpxx
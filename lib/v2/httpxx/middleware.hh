@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "httpxx/endpoint.hh"
+#include "httpxx/objects.hh"
+
+namespace httpxx {
+
+// Hooks a middleware can register; any of them may be left empty.
+//
+//   before_routing  runs on every parsed request and may rewrite it; returning
+//                   a response answers the request without routing it.
+//   after_routing   runs once the target is known (endpoint is nullptr for
+//                   static files); returning a response skips the handler.
+//   on_response     runs on every response produced for a parsed request,
+//                   including early ones, and may amend it.
+struct Middleware {
+  std::function<std::optional<Response>(Request&)> before_routing{};
+  std::function<std::optional<Response>(const Request&, const Endpoint*)>
+      after_routing{};
+  std::function<void(const Request&, Response&)> on_response{};
+};
+
+// The middleware of a router, flattened at startup into one array per stage
+// holding only the hooks that were actually set. A request pays one call per
+// registered hook of the stages it reaches and nothing for empty stages;
+// there are no per-request wrappers or next() continuations.
+class MiddlewareChain {
+ public:
+  void add(Middleware middleware) {
+    if (middleware.before_routing) {
+      before_routing_.push_back(std::move(middleware.before_routing));
+    }
+    if (middleware.after_routing) {
+      after_routing_.push_back(std::move(middleware.after_routing));
+    }
+    if (middleware.on_response) {
+      on_response_.push_back(std::move(middleware.on_response));
+    }
+  }
+
+  [[nodiscard]] std::optional<Response> beforeRouting(Request& request) const {
+    for (const auto& hook : before_routing_) {
+      if (auto response = hook(request)) {
+        return response;
+      }
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] std::optional<Response> afterRouting(
+      const Request& request, const Endpoint* endpoint) const {
+    for (const auto& hook : after_routing_) {
+      if (auto response = hook(request, endpoint)) {
+        return response;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Hooks run in reverse order of registration, so the first middleware
+  // added sees the response last, as with nested wrappers.
+  void onResponse(const Request& request, Response& response) const {
+    for (auto hook = on_response_.rbegin(); hook != on_response_.rend();
+         ++hook) {
+      (*hook)(request, response);
+    }
+  }
+
+  [[nodiscard]] bool empty() const {
+    return before_routing_.empty() && after_routing_.empty() &&
+           on_response_.empty();
+  }
+
+ private:
+  std::vector<std::function<std::optional<Response>(Request&)>>
+      before_routing_;
+  std::vector<
+      std::function<std::optional<Response>(const Request&, const Endpoint*)>>
+      after_routing_;
+  std::vector<std::function<void(const Request&, Response&)>> on_response_;
+};
+
+}  // namespace httpxx
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <fmt/format.h>
+
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <memory_resource>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
@@ -8,6 +14,9 @@
 #include <vector>
 
 #include "enums.hh"
+#include "fd_cache.hh"
+#include "headers.hh"
+#include "http_date.hh"
 
 template <class... Ts>
 struct overload : Ts... {
@@ -18,15 +27,23 @@ template <class... Ts>
 overload(Ts...) -> overload<Ts...>;
 namespace httpxx {
 
-using header_t = std::unordered_map<std::string, std::string>;
+using header_t = Headers;
 struct Request {
-  using parameter_t = std::unordered_map<std::string, std::string>;
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+  using parameter_t =
+      std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
 
   HttpMethod method{};
-  std::string uri{};
-  std::optional<std::string> body{};
+  std::pmr::string uri{};
+  std::optional<std::pmr::string> body{};
   header_t headers{};
   parameter_t request_parameters{};
+  bool keep_alive{true};
+
+  Request() = default;
+
+  explicit Request(allocator_type alloc)
+      : uri(alloc), headers(alloc), request_parameters(alloc) {}
 
   [[nodiscard]] bool requestsFile() const {
     if (uri.empty() || uri == "/") {
@@ -45,34 +62,107 @@ struct Request {
   }
 };
 
+struct FileBody {
+  FdCache::file_t file{};
+};
+
+struct MappedBody {
+  std::shared_ptr<const void> owner{};
+  std::string_view data{};
+};
+
 struct Response {
-  using response_body_t =
-      std::variant<std::monostate, std::string, std::vector<char>>;
+  using response_body_t = std::variant<std::monostate, std::string,
+                                       std::vector<char>, FileBody, MappedBody>;
 
   StatusCodes status_code{};
   header_t headers{};
   response_body_t body{std::monostate{}};
+  // Status line and fixed headers serialised ahead of time, each ending in
+  // CRLF; see ErrorResponses. Written verbatim in place of the status line,
+  // followed by the headers set on this response. Must outlive the response.
+  std::string_view prepared_head{};
+
+  template <typename String>
+  void appendHead(String& out) const {
+    if (prepared_head.empty()) {
+      fmt::format_to(std::back_inserter(out), "HTTP/1.1 {} {}\r\n",
+                     static_cast<int>(status_code), +status_code);
+    } else {
+      out.append(prepared_head);
+    }
 
-  [[nodiscard]] std::string toString() const {
-    std::stringstream ss{};
+    for (const auto& [key, value] : headers) {
+      out.append(key).append(": ").append(value).append("\r\n");
+    }
 
-    ss << "HTTP/1.1 " << static_cast<int>(status_code) << " " << +status_code
-       << "\r\n";
+    // On a kept-alive connection the client cannot wait for the close to
+    // find the end of the body, so every response that may carry one is
+    // framed, an empty one included. Prepared heads carry their own length.
+    if (prepared_head.empty() && mayHaveBody() &&
+        !headers.contains(HeaderId::CONTENT_LENGTH)) {
+      std::array<char, 20> digits{};
+      const auto end =
+          std::to_chars(digits.data(), digits.data() + digits.size(),
+                        bodySize())
+              .ptr;
+      out.append("Content-Length: ")
+          .append(std::string_view(digits.data(), end))
+          .append("\r\n");
+    }
 
-    for (const auto& [key, value] : headers) {
-      ss << key << ": " << value << "\r\n";
+    if (!headers.contains(HeaderId::DATE)) {
+      out.append(DateCache::global().line());
     }
 
-    ss << "\r\n";
+    out.append("\r\n");
+  }
+
+  // 1xx, 204 and 304 responses never have a body, nor a length for one.
+  [[nodiscard]] bool mayHaveBody() const {
+    const auto code = static_cast<int>(status_code);
+    return code >= 200 && status_code != StatusCodes::NO_CONTENT &&
+           status_code != StatusCodes::NOT_MODIFIED;
+  }
+
+  [[nodiscard]] std::size_t bodySize() const {
+    return std::visit(
+        overload{[](const std::monostate&) -> std::size_t { return 0; },
+                 [](const std::string& str) { return str.size(); },
+                 [](const std::vector<char>& vec) { return vec.size(); },
+                 [](const FileBody& file) { return file.file->size(); },
+                 [](const MappedBody& mapped) { return mapped.data.size(); }},
+        body);
+  }
+
+  [[nodiscard]] std::string headString() const {
+    std::string out;
+    appendHead(out);
+    return out;
+  }
+
+  [[nodiscard]] std::string toString() const {
+    std::string out = headString();
 
     std::visit(overload{[](const std::monostate&) { /* Empty body */ },
-                        [&ss](const std::string& str) { ss << str; },
-                        [&ss](const std::vector<char>& vec) {
-                          ss.write(vec.data(), vec.size());
+                        [&out](const std::string& str) { out += str; },
+                        [&out](const std::vector<char>& vec) {
+                          out.append(vec.data(), vec.size());
+                        },
+                        [&out](const FileBody& file) {
+                          const auto head = out.size();
+                          out.resize(head + file.file->size());
+                          const auto n = ::pread(file.file->fd(),
+                                                 out.data() + head,
+                                                 file.file->size(), 0);
+                          out.resize(head + (n > 0 ? n : 0));
+                        },
+                        [&out](const MappedBody& mapped) {
+                          out += mapped.data;
                         }},
                body);
 
-    return ss.str();
+    return out;
   }
 };
 
@@ -99,29 +189,46 @@ class ResponseBuilder {
     return *this;
   }
 
-  [[nodiscard]] ResponseBuilder& header(const std::string& key,
-                                        const std::string& value) {
-    response.headers[std::move(key)] = std::move(value);
+  [[nodiscard]] ResponseBuilder& header(std::string_view key,
+                                        std::string_view value) {
+    response.headers.set(key, value);
     return *this;
   }
 
-  [[nodiscard]] ResponseBuilder& contentType(const std::string type) {
-    return header("Content-Type", std::move(type));
+  [[nodiscard]] ResponseBuilder& header(HeaderId id, std::string_view value) {
+    response.headers.set(id, value);
+    return *this;
+  }
+
+  [[nodiscard]] ResponseBuilder& contentType(std::string_view type) {
+    return header(HeaderId::CONTENT_TYPE, type);
   }
 
   [[nodiscard]] ResponseBuilder& contentType(const ContentType type) {
-    return header("Content-Type", contentTypeToString(type));
+    return header(HeaderId::CONTENT_TYPE, contentTypeToString(type));
   }
 
-  [[nodiscard]] ResponseBuilder& body(const std::string& content) {
-    response.body = content;
+  [[nodiscard]] ResponseBuilder& body(std::string content) {
     setContentLength(content.length());
+    response.body = std::move(content);
+    return *this;
+  }
+
+  [[nodiscard]] ResponseBuilder& body(std::vector<char> content) {
+    setContentLength(content.size());
+    response.body = std::move(content);
+    return *this;
+  }
+
+  [[nodiscard]] ResponseBuilder& body(FileBody content) {
+    setContentLength(content.file->size());
+    response.body = std::move(content);
     return *this;
   }
 
-  [[nodiscard]] ResponseBuilder& body(const std::vector<char>& content) {
+  [[nodiscard]] ResponseBuilder& body(MappedBody content) {
+    setContentLength(content.data.size());
     response.body = std::move(content);
-    setContentLength(std::get<std::vector<char>>(response.body).size());
     return *this;
   }
 
@@ -149,7 +256,7 @@ class ResponseBuilder {
   Response response;
 
   void setContentLength(size_t length) {
-    header("Content-Length", std::to_string(length));
+    response.headers.set(HeaderId::CONTENT_LENGTH, std::to_string(length));
   }
 };
 }  // namespace httpxx
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#ifdef HTTPXX_PERF_COUNTERS
+#include <fmt/format.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#endif
+
+// Hardware performance counters read around the phases of sampled requests,
+// to tell cache misses from branch mispredicts from plain work in tail
+// latency. Counting is user space only, so time a phase spends in system
+// calls shows up as wall time without matching cycles. Only built when
+// HTTPXX_PERF_COUNTERS is defined (meson -Dperf_counters=enabled). Otherwise
+// PerfSample is empty, its member functions do nothing and the code that
+// reads counters compiles away.
+
+namespace httpxx {
+
+enum class HardwareCounter : uint8_t {
+  CYCLES,
+  INSTRUCTIONS,
+  BRANCH_MISSES,
+  L1D_MISSES,
+  LLC_MISSES
+};
+
+inline constexpr std::size_t hardware_counter_count = 5;
+inline constexpr std::array<std::string_view, hardware_counter_count>
+    hardware_counter_names{"cycles", "instructions", "branch_misses",
+                           "l1d_misses", "llc_misses"};
+
+using CounterValues = std::array<uint64_t, hardware_counter_count>;
+
+#ifdef HTTPXX_PERF_COUNTERS
+
+inline constexpr bool perf_counters_compiled = true;
+
+// The counters of the calling thread, user space only, opened as one group
+// so they are scheduled together and read with a single read().
+class PerfCounters {
+ public:
+  // nullptr, after logging why, when the kernel refuses the counters, e.g.
+  // because of perf_event_paranoid or a virtual machine without a PMU.
+  static std::unique_ptr<PerfCounters> open() {
+    std::unique_ptr<PerfCounters> counters(new PerfCounters());
+    constexpr std::array<std::pair<uint32_t, uint64_t>, hardware_counter_count>
+        events{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        }};
+    for (std::size_t i = 0; i < events.size(); ++i) {
+      perf_event_attr attr{};
+      attr.size = sizeof(attr);
+      attr.type = events[i].first;
+      attr.config = events[i].second;
+      attr.disabled = i == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      const int leader = i == 0 ? -1 : counters->fds_[0];
+      counters->fds_[i] = static_cast<int>(
+          ::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+      if (counters->fds_[i] == -1) {
+        std::clog << fmt::format(
+            "[httpx::PerfCounters] Cannot open {}: {}\n",
+            hardware_counter_names[i], std::strerror(errno));
+        return nullptr;
+      }
+    }
+    ::ioctl(counters->fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return counters;
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+    for (const int fd : fds_) {
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+  }
+
+  [[nodiscard]] CounterValues read() const {
+    struct {
+      uint64_t count;
+      CounterValues values;
+    } group{};
+    if (::read(fds_[0], &group, sizeof(group)) != sizeof(group)) {
+      return {};
+    }
+    return group.values;
+  }
+
+ private:
+  std::array<int, hardware_counter_count> fds_{-1, -1, -1, -1, -1};
+
+  PerfCounters() = default;
+};
+
+// Counter readings taken at the stages of one request: received, parsed,
+// routed, handled and written, as in RequestTiming. Inactive unless the
+// event loop armed it for a sampled request.
+class PerfSample {
+ public:
+  void arm(const PerfCounters* counters) { counters_ = counters; }
+
+  [[nodiscard]] bool active() const { return counters_ != nullptr; }
+
+  void read(std::size_t stage) {
+    if (counters_ != nullptr) {
+      readings_[stage] = counters_->read();
+    }
+  }
+
+  // Counts during one phase, indexed like Phase: parse, route, handler,
+  // write, and total.
+  [[nodiscard]] CounterValues phase(std::size_t phase) const {
+    const auto& from = readings_[phase < 4 ? phase : 0];
+    const auto& to = readings_[phase < 4 ? phase + 1 : 4];
+    CounterValues delta{};
+    for (std::size_t i = 0; i < delta.size(); ++i) {
+      delta[i] = to[i] - from[i];
+    }
+    return delta;
+  }
+
+ private:
+  const PerfCounters* counters_{nullptr};
+  std::array<CounterValues, 5> readings_{};
+};
+
+#else
+
+inline constexpr bool perf_counters_compiled = false;
+
+class PerfCounters {
+ public:
+  static std::unique_ptr<PerfCounters> open() { return nullptr; }
+};
+
+class PerfSample {
+ public:
+  void arm(const PerfCounters*) {}
+  [[nodiscard]] constexpr bool active() const { return false; }
+  void read(std::size_t) {}
+  [[nodiscard]] CounterValues phase(std::size_t) const { return {}; }
+};
+
+#endif
+
+}  // namespace httpxx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace httpxx {
+
+// Open-addressed table whose seed is searched at compile time so that every
+// key lands in its own slot: a lookup is one hash and one key comparison.
+template <typename Value, std::size_t N, bool FoldCase = false>
+class PerfectHashMap {
+ public:
+  using entry_t = std::pair<std::string_view, Value>;
+
+  static constexpr std::size_t slot_count = std::bit_ceil(N) * 8;
+  static constexpr uint32_t max_seed = 1 << 16;
+
+  consteval explicit PerfectHashMap(const std::array<entry_t, N>& entries) {
+    for (std::size_t i = 0; i < N; ++i) {
+      for (std::size_t j = i + 1; j < N; ++j) {
+        if (equal(entries[i].first, entries[j].first)) {
+          throw std::logic_error("PerfectHashMap: duplicate key");
+        }
+      }
+    }
+
+    for (uint32_t seed = 1; seed < max_seed; ++seed) {
+      if (tryBuild(entries, seed)) {
+        return;
+      }
+    }
+    throw std::logic_error("PerfectHashMap: no collision-free seed");
+  }
+
+  [[nodiscard]] constexpr const Value* find(std::string_view key) const {
+    const Slot& slot = slots_[hash(key, seed_) & (slot_count - 1)];
+    return slot.used && equal(slot.key, key) ? &slot.value : nullptr;
+  }
+
+  [[nodiscard]] constexpr bool contains(std::string_view key) const {
+    return find(key) != nullptr;
+  }
+
+ private:
+  struct Slot {
+    std::string_view key{};
+    Value value{};
+    bool used{false};
+  };
+
+  std::array<Slot, slot_count> slots_{};
+  uint32_t seed_{0};
+
+  static constexpr unsigned char fold(char c) {
+    const auto u = static_cast<unsigned char>(c);
+    return FoldCase && u >= 'A' && u <= 'Z' ? u | 0x20 : u;
+  }
+
+  static constexpr bool equal(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+      if (fold(lhs[i]) != fold(rhs[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Setting bit 5 unconditionally folds letters without a branch; other
+  // bytes it merges only share a bucket, equal() still tells them apart.
+  static constexpr uint32_t hash(std::string_view key, uint32_t seed) {
+    constexpr unsigned char case_bit = FoldCase ? 0x20 : 0;
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (const char c : key) {
+      h ^= static_cast<unsigned char>(c) | case_bit;
+      h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+  }
+
+  consteval bool tryBuild(const std::array<entry_t, N>& entries,
+                          uint32_t seed) {
+    slots_ = {};
+    seed_ = seed;
+    for (const auto& [key, value] : entries) {
+      Slot& slot = slots_[hash(key, seed) & (slot_count - 1)];
+      if (slot.used) {
+        return false;
+      }
+      slot = {key, value, true};
+    }
+    return true;
+  }
+};
+
+}  // namespace httpxx
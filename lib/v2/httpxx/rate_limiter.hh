@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace httpxx {
+
+// Requests per second a client may make, and how many it may make at once
+// after being idle. A rate of zero means unlimited.
+struct RateLimit {
+  double rate{0};
+  double burst{1};
+
+  [[nodiscard]] bool enabled() const { return rate > 0; }
+
+  friend bool operator==(const RateLimit&, const RateLimit&) = default;
+};
+
+// Token buckets for any number of clients, shared by every worker. Buckets
+// are kept in GCRA form, as the time at which the bucket would be full
+// again, so refilling is a subtraction done lazily on use and a bucket whose
+// time has passed is indistinguishable from a missing one; evictIdle() drops
+// those. Keys are 64-bit hashes of whatever identifies the client. They are
+// spread over lock-striped shards, each an open-addressing table of 16-byte
+// entries, so a client costs about 32 bytes and workers rarely contend for
+// the same lock.
+class RateLimiter {
+ public:
+  using clock = std::chrono::steady_clock;
+  static constexpr std::size_t shard_bits = 6;
+  static constexpr std::size_t shard_count = std::size_t{1} << shard_bits;
+
+  explicit RateLimiter(clock::time_point epoch = clock::now())
+      : epoch_(epoch) {}
+
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  // Takes a token from key's bucket. Returns nullopt when the request may
+  // proceed, otherwise how long until it would.
+  std::optional<clock::duration> acquire(uint64_t key, const RateLimit& limit,
+                                         clock::time_point now) {
+    key = mix(key);
+    const int64_t at = nanos(now);
+    const auto interval = static_cast<int64_t>(1e9 / limit.rate);
+    const auto tolerance =
+        static_cast<int64_t>(static_cast<double>(interval) *
+                             std::max(limit.burst, 1.0));
+
+    Shard& shard = shards_[key >> (64 - shard_bits)];
+    std::lock_guard lock(shard.mutex);
+    Entry& entry = shard.findOrInsert(key, at);
+    const int64_t full_at = std::max(entry.full_at, at) + interval;
+    if (full_at - at > tolerance) {
+      return std::chrono::nanoseconds(full_at - at - tolerance);
+    }
+    entry.full_at = full_at;
+    return std::nullopt;
+  }
+
+  // Drops the idle buckets of the next shard in turn and returns how many
+  // were dropped. Meant to be called periodically from any thread.
+  std::size_t evictIdle(clock::time_point now) {
+    const auto next = sweep_cursor_.fetch_add(1, std::memory_order_relaxed);
+    Shard& shard = shards_[next % shard_count];
+    std::lock_guard lock(shard.mutex);
+    return shard.evictBefore(nanos(now));
+  }
+
+  [[nodiscard]] std::size_t size() {
+    std::size_t total = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      total += shard.size;
+    }
+    return total;
+  }
+
+ private:
+  struct Entry {
+    uint64_t key{0};
+    int64_t full_at{0};
+  };
+
+  // Linear probing with backward-shift deletion, so there are no tombstones
+  // and eviction leaves probe sequences as short as a fresh insert would.
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::vector<Entry> slots;
+    std::size_t size{0};
+
+    Entry& findOrInsert(uint64_t key, int64_t now) {
+      if ((size + 1) * 4 > slots.size() * 3) {
+        rehash(std::max<std::size_t>(16, slots.size() * 2));
+      }
+      const std::size_t mask = slots.size() - 1;
+      std::size_t index = key & mask;
+      while (slots[index].key != 0 && slots[index].key != key) {
+        index = (index + 1) & mask;
+      }
+      if (slots[index].key == 0) {
+        slots[index] = {key, now};
+        ++size;
+      }
+      return slots[index];
+    }
+
+    std::size_t evictBefore(int64_t now) {
+      std::size_t evicted = 0;
+      for (std::size_t index = 0; index < slots.size();) {
+        if (slots[index].key != 0 && slots[index].full_at <= now) {
+          erase(index);
+          ++evicted;
+        } else {
+          ++index;
+        }
+      }
+      return evicted;
+    }
+
+    void erase(std::size_t hole) {
+      const std::size_t mask = slots.size() - 1;
+      for (std::size_t next = (hole + 1) & mask; slots[next].key != 0;
+           next = (next + 1) & mask) {
+        const std::size_t home = slots[next].key & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+          slots[hole] = slots[next];
+          hole = next;
+        }
+      }
+      slots[hole] = Entry{};
+      --size;
+    }
+
+    void rehash(std::size_t capacity) {
+      std::vector<Entry> old(capacity);
+      old.swap(slots);
+      const std::size_t mask = capacity - 1;
+      for (const Entry& entry : old) {
+        if (entry.key == 0) {
+          continue;
+        }
+        std::size_t index = entry.key & mask;
+        while (slots[index].key != 0) {
+          index = (index + 1) & mask;
+        }
+        slots[index] = entry;
+      }
+    }
+  };
+
+  clock::time_point epoch_;
+  std::array<Shard, shard_count> shards_;
+  std::atomic<std::size_t> sweep_cursor_{0};
+
+  [[nodiscard]] int64_t nanos(clock::time_point now) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now - epoch_)
+        .count();
+  }
+
+  // Final step of splitmix64. The top bits pick the shard and the low ones
+  // the slot, so both need to be well mixed; zero marks an empty slot.
+  static uint64_t mix(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key == 0 ? 1 : key;
+  }
+};
+
+}  // namespace httpxx
@@ -1,27 +1,82 @@
 #pragma once
 #include <fmt/format.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
 #include <filesystem>
-#include <fstream>
+#include <limits>
+#include <memory_resource>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 
+#include "httpxx/asset_pack.hh"
+#include "httpxx/buffer_pool.hh"
 #include "httpxx/configuration.hh"
 #include "httpxx/endpoint.hh"
 #include "httpxx/objects.hh"
+#include "httpxx/perf_counters.hh"
 #include "httpxx/router.hh"
 
 namespace httpxx {
 
+// A request that is not valid HTTP; answered with 400 Bad Request.
+class ParseError : public std::runtime_error {
+ public:
+  explicit ParseError(const std::string& message)
+      : std::runtime_error(message) {}
+};
+
 class HttpUtils {
  public:
+  // The number in e.g. "HTTP/1.1". Throws ParseError when there is none.
   static float extractHttpVersion(std::string_view http_version) {
     std::string version;
     std::copy_if(http_version.begin(), http_version.end(),
                  std::back_inserter(version),
                  [](char c) { return std::isdigit(c) || c == '.'; });
-    return std::stof(version);
+    float number = 0;
+    const auto [end, ec] =
+        std::from_chars(version.data(), version.data() + version.size(),
+                        number, std::chars_format::fixed);
+    if (ec != std::errc{} || end != version.data() + version.size()) {
+      throw ParseError("Invalid HTTP version");
+    }
+    return number;
+  }
+
+  static std::string_view trim(std::string_view str) {
+    constexpr std::string_view whitespace = " \t\r";
+    const auto first = str.find_first_not_of(whitespace);
+    if (first == std::string_view::npos) {
+      return {};
+    }
+    return str.substr(first, str.find_last_not_of(whitespace) - first + 1);
+  }
+
+  static bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return std::ranges::equal(lhs, rhs, [](unsigned char a, unsigned char b) {
+      return std::tolower(a) == std::tolower(b);
+    });
+  }
+
+  // Removes the first element of a comma-separated header value from list
+  // and returns it trimmed.
+  static std::string_view popListElement(std::string_view& list) {
+    const auto comma = list.find(',');
+    const auto element = list.substr(0, comma);
+    list.remove_prefix(comma == std::string_view::npos ? list.size()
+                                                       : comma + 1);
+    return trim(element);
   }
 
   static std::vector<std::string> splitString(std::string_view str,
@@ -50,201 +105,622 @@ class HttpUtils {
 
 class RequestParser {
  public:
-  static Request parse(std::string_view request_string) {
-    std::istringstream iss((std::string(request_string)));
-    return parseRequestLine(iss);
+  static Request parse(std::string_view request_string,
+                       std::pmr::memory_resource* resource =
+                           std::pmr::get_default_resource()) {
+    Request request{Request::allocator_type(resource)};
+    parseRequestLine(request_string, request);
+    parseHeaders(request_string, request);
+    parseBody(request_string, request);
+    return request;
   }
 
- private:
-  static Request parseRequestLine(std::istringstream& iss) {
-    std::string line;
-    std::getline(iss, line);
+  // Size of the request line and headers including the blank line that ends
+  // them, or nullopt while that blank line has not arrived. A caller that
+  // already searched the first `scanned` bytes of data passes their number
+  // so they are not searched again.
+  static std::optional<std::size_t> headLength(std::string_view data,
+                                               std::size_t scanned = 0) {
+    const auto from = scanned < 3 ? 0 : scanned - 3;
+    const auto crlf = data.find("\r\n\r\n", from);
+    const auto lf = data.find("\n\n", from);
+    if (crlf == data.npos && lf == data.npos) {
+      return std::nullopt;
+    }
+    return crlf < lf ? crlf + 4 : lf + 2;
+  }
 
-    if (line.find("HTTP") == std::string::npos) {
-      throw std::runtime_error("Invalid HTTP request");
+  // Size of the first complete request in data (head plus Content-Length
+  // bytes of body), or nullopt while more bytes are needed. Throws
+  // ParseError when the end of the request cannot be told unambiguously,
+  // see bodyLength().
+  static std::optional<std::size_t> messageLength(std::string_view data) {
+    const auto head_length = headLength(data);
+    if (!head_length) {
+      return std::nullopt;
+    }
+    const auto body_length = bodyLength(data.substr(0, *head_length));
+    if (body_length > data.size() - *head_length) {
+      return std::nullopt;
     }
+    return *head_length + body_length;
+  }
 
-    auto parts = HttpUtils::splitString(line, " ");
-    if (parts.size() != 3) {
-      throw std::runtime_error("Invalid request line format");
+  // Content-Length of the request whose head is given, 0 without one.
+  // Throws ParseError for framing that a proxy in front of the server might
+  // read differently: a value that is not a plain number or does not fit
+  // next to the head, several differing values, whitespace before the colon
+  // of either framing header, and any Transfer-Encoding, as chunked bodies
+  // are not supported.
+  static std::size_t bodyLength(std::string_view head) {
+    std::optional<std::size_t> content_length;
+    const auto head_length = head.size();
+    nextLine(head);
+    while (!head.empty()) {
+      const auto line = nextLine(head);
+      const auto colon = line.find(':');
+      if (colon == std::string_view::npos) {
+        continue;
+      }
+      const auto name = line.substr(0, colon);
+      const auto id = headerIdFromName(HttpUtils::trim(name));
+      if (id != HeaderId::CONTENT_LENGTH &&
+          id != HeaderId::TRANSFER_ENCODING) {
+        continue;
+      }
+      if (HttpUtils::trim(name).size() != name.size()) {
+        throw ParseError("Whitespace in framing header name");
+      }
+      if (id == HeaderId::TRANSFER_ENCODING) {
+        throw ParseError("Transfer-Encoding is not supported");
+      }
+
+      const auto value = HttpUtils::trim(line.substr(colon + 1));
+      std::size_t length = 0;
+      const auto [end, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), length);
+      if (value.empty() || ec != std::errc{} ||
+          end != value.data() + value.size() ||
+          length > std::numeric_limits<std::size_t>::max() - head_length) {
+        throw ParseError("Invalid Content-Length");
+      }
+      if (content_length && *content_length != length) {
+        throw ParseError("Conflicting Content-Length");
+      }
+      content_length = length;
     }
+    return content_length.value_or(0);
+  }
 
-    Request request;
-    request.method = stringToHttpMethod(parts[0]);
-    parseUri(parts[1], request);
+  // Path of the request target in the request line, without the query, or
+  // an empty view if the line is malformed. Cheaper than parse() for
+  // decisions that only depend on the route.
+  static std::string_view target(std::string_view data) {
+    const auto line = nextLine(data);
+    const auto first_space = line.find(' ');
+    const auto last_space = line.rfind(' ');
+    if (first_space == std::string_view::npos || first_space == last_space) {
+      return {};
+    }
+    const auto uri = line.substr(first_space + 1, last_space - first_space - 1);
+    return uri.substr(0, uri.find('?'));
+  }
 
-    parseHeaders(iss, request);
-    parseBody(iss, request);
+  // Value of the first header called name in the head of data, without
+  // parsing the rest of the request.
+  static std::optional<std::string_view> header(std::string_view data,
+                                                std::string_view name) {
+    auto rest = data.substr(0, headLength(data).value_or(data.size()));
+    nextLine(rest);
+    while (!rest.empty()) {
+      const auto line = nextLine(rest);
+      const auto colon = line.find(':');
+      if (colon != std::string_view::npos &&
+          HttpUtils::equalsIgnoreCase(line.substr(0, colon), name)) {
+        return HttpUtils::trim(line.substr(colon + 1));
+      }
+    }
+    return std::nullopt;
+  }
 
-    return request;
+ private:
+  // Returns the next line without its line terminator and advances rest
+  // past it.
+  static std::string_view nextLine(std::string_view& rest) {
+    const auto newline = rest.find('\n');
+    auto line = rest.substr(0, newline);
+    rest.remove_prefix(newline == std::string_view::npos ? rest.size()
+                                                         : newline + 1);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    return line;
+  }
+
+  static void parseRequestLine(std::string_view& rest, Request& request) {
+    const auto line = nextLine(rest);
+
+    if (line.find("HTTP") == std::string_view::npos) {
+      throw ParseError("Invalid HTTP request");
+    }
+
+    const auto first_space = line.find(' ');
+    const auto last_space = line.rfind(' ');
+    if (first_space == std::string_view::npos || first_space == last_space ||
+        line.find(' ', first_space + 1) != last_space ||
+        last_space == first_space + 1) {
+      throw ParseError("Invalid request line format");
+    }
+
+    const auto method = line.substr(0, first_space);
+    if (!isValidHttpMethod(method)) {
+      throw ParseError("Unknown method");
+    }
+    request.method = stringToHttpMethod(method);
+    parseUri(line.substr(first_space + 1, last_space - first_space - 1),
+             request);
+    request.keep_alive = line.substr(last_space + 1) != "HTTP/1.0";
   }
 
   static void parseUri(std::string_view uri, Request& request) {
     auto questionMark = uri.find('?');
+    request.uri = uri.substr(0, questionMark);
     if (questionMark == std::string_view::npos) {
-      request.uri = std::string(uri);
       return;
     }
 
-    request.uri = std::string(uri.substr(0, questionMark));
-    auto params = HttpUtils::splitString(uri.substr(questionMark + 1), "&");
-
-    for (const auto& param : params) {
-      auto kvPair = HttpUtils::splitString(param, "=");
-      if (kvPair.size() == 2) {
-        request.request_parameters[kvPair[0]] = kvPair[1];
+    auto query = uri.substr(questionMark + 1);
+    while (!query.empty()) {
+      const auto amp = query.find('&');
+      const auto param = query.substr(0, amp);
+      query.remove_prefix(amp == std::string_view::npos ? query.size()
+                                                        : amp + 1);
+
+      const auto eq = param.find('=');
+      if (eq == std::string_view::npos ||
+          param.find('=', eq + 1) != std::string_view::npos) {
+        continue;
       }
+      request.request_parameters.insert_or_assign(
+          std::pmr::string(param.substr(0, eq),
+                           request.request_parameters.get_allocator()),
+          param.substr(eq + 1));
     }
   }
 
-  static void parseHeaders(std::istringstream& iss, Request& request) {
-    std::string line;
-    while (std::getline(iss, line) && !line.empty() && line != "\r") {
-      auto parts = HttpUtils::splitString(line, ":");
-      if (parts.size() == 2) {
-        request.headers[parts[0]] = parts[1];
+  static void parseHeaders(std::string_view& rest, Request& request) {
+    while (!rest.empty()) {
+      const auto line = nextLine(rest);
+      if (line.empty()) {
+        break;
+      }
+
+      const auto colon = line.find(':');
+      if (colon == std::string_view::npos || colon == 0) {
+        continue;
+      }
+      request.headers.add(line.substr(0, colon),
+                          HttpUtils::trim(line.substr(colon + 1)));
+    }
+
+    if (auto connection = request.headers.get(HeaderId::CONNECTION)) {
+      if (HttpUtils::equalsIgnoreCase(*connection, "close")) {
+        request.keep_alive = false;
+      } else if (HttpUtils::equalsIgnoreCase(*connection, "keep-alive")) {
+        request.keep_alive = true;
       }
     }
   }
 
-  static void parseBody(std::istringstream& iss, Request& request) {
-    std::string body;
-    if (std::getline(iss, body)) {
-      request.body = body;
+  static void parseBody(std::string_view rest, Request& request) {
+    if (auto length = request.headers.get(HeaderId::CONTENT_LENGTH)) {
+      std::size_t content_length = 0;
+      auto [end, ec] = std::from_chars(
+          length->data(), length->data() + length->size(), content_length);
+      if (ec == std::errc{} && end == length->data() + length->size()) {
+        rest = rest.substr(0, content_length);
+      }
+    }
+
+    if (!rest.empty()) {
+      request.body.emplace(rest, request.uri.get_allocator());
     }
   }
 };
 
-class ResponseWriter {
+enum class WriteStatus { DONE, BLOCKED, FAILED };
+
+// A response on its way out. The head is serialised into a pooled send
+// buffer and goes out together with an in-memory body in a single writev();
+// file bodies follow via sendfile(). write() sends as much as the socket
+// takes and, on a non-blocking socket, picks up where it stopped when called
+// again after EPOLLOUT.
+class OutgoingResponse {
  public:
-  static void write(const Response& response, int client_fd) {
-    writeHeaders(response, client_fd);
-    writeBody(response, client_fd);
+  explicit OutgoingResponse(Response response)
+      : response_(std::move(response)),
+        head_(BufferPool::local().acquire()) {
+    response_.appendHead(head_);
+    if (head_.truncated()) {
+      head_.release();
+      response_.appendHead(oversized_head_);
+    }
+  }
+
+  // A response serialised ahead of time: head holds the status line and
+  // headers, without the Date header and the blank line, which are added
+  // here. Nothing is formatted, so this is cheap enough to use for shedding.
+  OutgoingResponse(StatusCodes status, std::string_view head)
+      : head_(BufferPool::local().acquire()) {
+    response_.status_code = status;
+    head_.append(head)
+        .append(DateCache::global().line())
+        .append(std::string_view("\r\n"));
+  }
+
+  [[nodiscard]] const Response& response() const { return response_; }
+
+  // Bytes the whole response takes on the wire.
+  [[nodiscard]] std::size_t size() const {
+    const auto* file = std::get_if<FileBody>(&response_.body);
+    return head().size() + inMemoryBody().size() +
+           (file != nullptr ? file->file->size() : 0);
+  }
+
+  [[nodiscard]] std::size_t bytesSent() const {
+    return head_sent_ + body_sent_ + static_cast<std::size_t>(file_offset_);
+  }
+
+  WriteStatus write(int client_fd) {
+    while (true) {
+      const auto head = this->head().substr(head_sent_);
+      const auto body = inMemoryBody().substr(body_sent_);
+      if (head.empty() && body.empty()) {
+        break;
+      }
+
+      std::array<iovec, 2> parts{
+          iovec{const_cast<char*>(head.data()), head.size()},
+          iovec{const_cast<char*>(body.data()), body.size()}};
+      const auto written = ::writev(client_fd, parts.data(), 2);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? WriteStatus::BLOCKED
+                                                       : WriteStatus::FAILED;
+      }
+
+      const auto sent = static_cast<std::size_t>(written);
+      head_sent_ += std::min(sent, head.size());
+      body_sent_ += sent - std::min(sent, head.size());
+    }
+
+    if (const auto* file = std::get_if<FileBody>(&response_.body)) {
+      return sendFile(*file->file, client_fd);
+    }
+    return WriteStatus::DONE;
   }
 
  private:
-  static void writeHeaders(const Response& response, int client_fd) {
-    const std::string headers = response.toString();
-    ::write(client_fd, headers.c_str(), headers.length());
+  Response response_;
+  PooledBuffer head_;
+  std::string oversized_head_;
+  std::size_t head_sent_{0};
+  std::size_t body_sent_{0};
+  off_t file_offset_{0};
+
+  [[nodiscard]] std::string_view head() const {
+    return head_.empty() ? std::string_view(oversized_head_) : head_.view();
   }
 
-  static void writeBody(const Response& response, int client_fd) {
-    std::visit(overload{[](std::monostate) {},
-                        [client_fd](const std::string& str) {
-                          ::write(client_fd, str.c_str(), str.length());
-                        },
-                        [client_fd](const std::vector<char>& vec) {
-                          ::write(client_fd, vec.data(), vec.size());
-                        }},
-               response.body);
+  [[nodiscard]] std::string_view inMemoryBody() const {
+    return std::visit(
+        overload{[](std::monostate) { return std::string_view{}; },
+                 [](const std::string& str) { return std::string_view(str); },
+                 [](const std::vector<char>& vec) {
+                   return std::string_view(vec.data(), vec.size());
+                 },
+                 [](const FileBody&) { return std::string_view{}; },
+                 [](const MappedBody& body) { return body.data; }},
+        response_.body);
+  }
+
+  WriteStatus sendFile(const CachedFile& file, int client_fd) {
+    const auto size = static_cast<off_t>(file.size());
+    while (file_offset_ < size) {
+      const auto sent =
+          ::sendfile(client_fd, file.fd(), &file_offset_, size - file_offset_);
+      if (sent < 0 && errno == EINTR) {
+        continue;
+      }
+      if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return WriteStatus::BLOCKED;
+      }
+      if (sent <= 0) {
+        return WriteStatus::FAILED;
+      }
+    }
+    return WriteStatus::DONE;
+  }
+};
+
+class ResponseWriter {
+ public:
+  // Sends the whole response on a blocking socket.
+  static void write(Response response, int client_fd) {
+    OutgoingResponse(std::move(response)).write(client_fd);
   }
 };
 
 class FileServer {
  public:
-  static Response serveFile(const std::filesystem::path& path) {
-    if (!std::filesystem::exists(path)) {
-      return createErrorResponse(StatusCodes::NOT_FOUND,
-                                 "404 - File Not Found");
+  static void mountAssetPack(std::shared_ptr<const AssetPack> pack) {
+    assetPack() = std::move(pack);
+  }
+
+  static Response serve(const Config& config, const Request& request) {
+    if (const auto& pack = assetPack()) {
+      std::string_view path = request.uri;
+      path.remove_prefix(std::min(path.find_first_not_of('/'), path.size()));
+      if (auto asset = pack->find(path)) {
+        return serveAsset(pack, *asset, request);
+      }
     }
 
+    return serveFile(
+        fmt::format("{}{}", config.getWwwPath().string(), request.uri));
+  }
+
+  static Response serveFile(const std::filesystem::path& path) {
     try {
-      ContentType contentType = getContentTypeFromFilename(path);
-      return isTextFile(contentType) ? serveTextFile(path, contentType)
-                                     : serveBinaryFile(path, contentType);
-    } catch (const std::exception& e) {
-      std::clog << "File serving error: " << e.what() << '\n';
-      return createErrorResponse(StatusCodes::INTERNAL_SERVER_ERROR,
-                                 "500 - Internal Server Error");
+      auto file = FdCache::global().open(path);
+      if (!file) {
+        return ErrorResponses::fileNotFound();
+      }
+
+      return ResponseBuilder::ok()
+          .contentType(getContentTypeFromFilename(path.native()))
+          .body(FileBody{std::move(file)})
+          .build();
+    } catch (const std::exception&) {
+      return ErrorResponses::internalError();
     }
   }
 
  private:
-  static Response serveTextFile(const std::filesystem::path& path,
-                                ContentType contentType) {
-    std::ifstream ifs(path);
-    std::string content((std::istreambuf_iterator<char>(ifs)),
-                        std::istreambuf_iterator<char>());
-
-    return ResponseBuilder::ok()
-        .contentType(contentTypeToString(contentType))
-        .body(content)
-        .build();
-  }
-
-  static Response serveBinaryFile(const std::filesystem::path& path,
-                                  ContentType contentType) {
-    std::ifstream ifs(path, std::ios::binary);
-    std::vector<char> buffer{std::istreambuf_iterator<char>(ifs),
-                             std::istreambuf_iterator<char>()};
-
-    return ResponseBuilder::ok()
-        .contentType(contentTypeToString(contentType))
-        .body(buffer)
-        .build();
-  }
-
-  static Response createErrorResponse(StatusCodes status,
-                                      const std::string& message) {
-    return ResponseBuilder()
-        .status(status)
-        .contentType("text/html")
-        .body(fmt::format("<h1>{}</h1>", message))
-        .build();
+  static std::shared_ptr<const AssetPack>& assetPack() {
+    static std::shared_ptr<const AssetPack> pack;
+    return pack;
+  }
+
+  static Response serveAsset(const std::shared_ptr<const AssetPack>& pack,
+                             const Asset& asset, const Request& request) {
+    const bool has_gzip = !asset.gzip.empty();
+    if (matchesEtag(request, asset.etag)) {
+      auto response = ResponseBuilder()
+                          .status(StatusCodes::NOT_MODIFIED)
+                          .header(HeaderId::ETAG, asset.etag)
+                          .build();
+      if (has_gzip) {
+        response.headers.set(HeaderId::VARY, "Accept-Encoding");
+      }
+      return response;
+    }
+
+    const bool use_gzip = has_gzip && acceptsGzip(request);
+    const auto body = use_gzip ? asset.gzip : asset.body;
+    auto response = ResponseBuilder::ok()
+                        .contentType(asset.content_type)
+                        .header(HeaderId::ETAG, asset.etag)
+                        .body(MappedBody{pack, body})
+                        .build();
+
+    if (has_gzip) {
+      response.headers.set(HeaderId::VARY, "Accept-Encoding");
+    }
+    if (use_gzip) {
+      response.headers.set(HeaderId::CONTENT_ENCODING, "gzip");
+    }
+    return response;
   }
+
+  // If-None-Match, compared weakly as RFC 9110 requires.
+  static bool matchesEtag(const Request& request, std::string_view etag) {
+    auto tags = request.headers.get(HeaderId::IF_NONE_MATCH);
+    if (!tags) {
+      return false;
+    }
+
+    std::string_view list = *tags;
+    while (!list.empty()) {
+      auto tag = HttpUtils::popListElement(list);
+      if (tag.starts_with("W/")) {
+        tag.remove_prefix(2);
+      }
+      if (tag == "*" || tag == etag) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // gzip is acceptable when Accept-Encoding gives it, or failing that "*", a
+  // non-zero q-value.
+  static bool acceptsGzip(const Request& request) {
+    auto encodings = request.headers.get(HeaderId::ACCEPT_ENCODING);
+    if (!encodings) {
+      return false;
+    }
+
+    auto quality = codingQuality(*encodings, "gzip");
+    if (!quality) {
+      quality = codingQuality(*encodings, "*");
+    }
+    return quality.value_or(0) > 0;
+  }
+
+  // The q-value of coding in an Accept-Encoding list, 1 when it carries none
+  // and 0 when it is malformed; nullopt when the coding is not listed.
+  static std::optional<float> codingQuality(std::string_view list,
+                                            std::string_view coding) {
+    while (!list.empty()) {
+      const auto element = HttpUtils::popListElement(list);
+      const auto semicolon = element.find(';');
+      if (!HttpUtils::equalsIgnoreCase(
+              HttpUtils::trim(element.substr(0, semicolon)), coding)) {
+        continue;
+      }
+      if (semicolon == std::string_view::npos) {
+        return 1.0F;
+      }
+
+      const auto weight = HttpUtils::trim(element.substr(semicolon + 1));
+      if (weight.size() < 2 || std::tolower(weight[0]) != 'q' ||
+          weight[1] != '=') {
+        return 0.0F;
+      }
+      const auto value = HttpUtils::trim(weight.substr(2));
+      float q = 0;
+      const auto [end, ec] = std::from_chars(
+          value.data(), value.data() + value.size(), q,
+          std::chars_format::fixed);
+      if (ec != std::errc{} || end != value.data() + value.size()) {
+        return 0.0F;
+      }
+      return q;
+    }
+    return std::nullopt;
+  }
+};
+
+// When RequestHandler::respond() reached each stage of a request, which
+// Router::route_id() answered it, and its method, unset when it did not
+// parse. Stages a request skipped, e.g. routing for a request answered by
+// middleware, carry the time of the next one.
+struct RequestTiming {
+  using clock = std::chrono::steady_clock;
+
+  // Where perf reads hardware counters, when armed.
+  enum Stage : std::size_t { RECEIVED, PARSED, ROUTED, HANDLED, WRITTEN };
+
+  std::size_t route{0};
+  std::optional<HttpMethod> method;
+  clock::time_point received{};
+  clock::time_point parsed{};
+  clock::time_point routed{};
+  clock::time_point handled{};
+  [[no_unique_address]] PerfSample perf;
 };
 
 class RequestHandler {
  public:
   static void handle(const Router& router, const Config& config, int client_fd,
-                     std::string_view buffer) {
+                     std::string_view buffer,
+                     std::pmr::memory_resource* resource =
+                         std::pmr::get_default_resource()) {
+    ResponseWriter::write(respond(router, config, buffer, resource),
+                          client_fd);
+    close(client_fd);
+  }
+
+  static Response respond(const Router& router, const Config& config,
+                          std::string_view buffer,
+                          std::pmr::memory_resource* resource =
+                              std::pmr::get_default_resource(),
+                          RequestTiming* timing = nullptr) {
+    RequestTiming untimed;
+    auto& t = timing != nullptr ? *timing : untimed;
+    t.route = router.unmatched_route();
+    t.method.reset();
+    t.received = RequestTiming::clock::now();
+    t.parsed = t.routed = t.handled = {};
+    t.perf.read(RequestTiming::RECEIVED);
     try {
-      auto request = RequestParser::parse(buffer);
-      auto response = handleRequest(router, config, request);
-      ResponseWriter::write(response, client_fd);
-    } catch (const std::exception& e) {
-      handleError(e, client_fd);
+      auto request = RequestParser::parse(buffer, resource);
+      t.method = request.method;
+      t.parsed = RequestTiming::clock::now();
+      t.perf.read(RequestTiming::PARSED);
+      auto response = handleRequest(router, config, request, t);
+      if (!request.keep_alive) {
+        response.headers.set(HeaderId::CONNECTION, "close");
+      } else if (request.headers.contains(HeaderId::CONNECTION)) {
+        response.headers.set(HeaderId::CONNECTION, "keep-alive");
+      }
+      return response;
+    } catch (const ParseError&) {
+      auto response = ErrorResponses::badRequest();
+      response.headers.set(HeaderId::CONNECTION, "close");
+      settle(t);
+      return response;
+    } catch (const std::exception&) {
+      // Counted by status class in the metrics and written to the access
+      // log; nothing is logged synchronously on the worker.
+      auto response = ErrorResponses::internalError();
+      response.headers.set(HeaderId::CONNECTION, "close");
+      settle(t);
+      return response;
     }
-    close(client_fd);
   }
 
  private:
   static Response handleRequest(const Router& router, const Config& config,
-                                const Request& request) {
+                                Request& request, RequestTiming& timing) {
+    const auto& chain = router.middleware();
+    auto response = dispatch(router, config, chain, request, timing);
+    chain.onResponse(request, response);
+    settle(timing);
+    return response;
+  }
+
+  static Response dispatch(const Router& router, const Config& config,
+                           const MiddlewareChain& chain, Request& request,
+                           RequestTiming& timing) {
+    if (auto response = chain.beforeRouting(request)) {
+      return std::move(*response);
+    }
+
     if (request.requestsFile()) {
-      return FileServer::serveFile(
-          fmt::format("{}{}", config.getWwwPath().string(), request.uri));
+      timing.route = router.static_route();
+      if (auto response = chain.afterRouting(request, nullptr)) {
+        return std::move(*response);
+      }
+      timing.routed = RequestTiming::clock::now();
+      timing.perf.read(RequestTiming::ROUTED);
+      return FileServer::serve(config, request);
     }
 
-    auto endpoint = router.get_endpoint(request.uri);
-    if (!isMethodAllowed(endpoint, request.method)) {
-      return createMethodNotAllowedResponse(request);
+    const auto& endpoint = router.get_endpoint(request.uri, request.method);
+    timing.route = router.route_id(endpoint);
+    if (&endpoint != &Router::not_found() &&
+        !isMethodAllowed(endpoint, request.method)) {
+      return ErrorResponses::methodNotAllowed(request.method, request.uri);
+    }
+    if (auto response = chain.afterRouting(request, &endpoint)) {
+      return std::move(*response);
     }
 
+    timing.routed = RequestTiming::clock::now();
+    timing.perf.read(RequestTiming::ROUTED);
     return endpoint.handler(request);
   }
 
+  // Stamps the stages a request did not get to with the current time.
+  static void settle(RequestTiming& timing) {
+    const auto now = RequestTiming::clock::now();
+    timing.handled = now;
+    timing.perf.read(RequestTiming::HANDLED);
+    if (timing.parsed < timing.received) {
+      timing.parsed = now;
+      timing.perf.read(RequestTiming::PARSED);
+    }
+    if (timing.routed < timing.parsed) {
+      timing.routed = now;
+      timing.perf.read(RequestTiming::ROUTED);
+    }
+  }
+
   static bool isMethodAllowed(const Endpoint& endpoint, HttpMethod method) {
     return std::ranges::find(endpoint.accepted_methods, method) !=
            std::end(endpoint.accepted_methods);
   }
-
-  static Response createMethodNotAllowedResponse(const Request& request) {
-    auto error =
-        fmt::format(R"({{"error": "Method {} is not allowed on URI {}"}})",
-                    +request.method, request.uri);
-
-    return ResponseBuilder()
-        .status(StatusCodes::METHOD_NOT_ALLOWED)
-        .json(nlohmann::json::parse(error))
-        .build();
-  }
-
-  static void handleError(const std::exception& e, int client_fd) {
-    std::clog << e.what() << '\n';
-    ResponseWriter::write(
-        ResponseBuilder().status(StatusCodes::INTERNAL_SERVER_ERROR).build(),
-        client_fd);
-  }
 };
 }
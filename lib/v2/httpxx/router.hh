@@ -6,42 +6,113 @@
 
 #include "httpxx/endpoint.hh"
 #include "httpxx/enums.hh"
+#include "httpxx/error_responses.hh"
+#include "httpxx/middleware.hh"
 
 namespace httpxx {
 
-using handler_t = std::function<Response(Request)>;
+using handler_t = std::function<Response(const Request&)>;
 
 class Router {
  public:
   Router() = default;
 
   void add_endpoint(std::string path, std::vector<HttpMethod> accepted_methods,
-                    handler_t handler_function) {
+                    handler_t handler_function,
+                    Priority priority = Priority::NORMAL) {
     endpoints.emplace_back(std::move(path), std::move(accepted_methods),
-                           std::move(handler_function));
+                           std::move(handler_function), priority);
   }
 
-  [[nodiscard]] const Endpoint& get_endpoint(std::string_view path) const {
+  // Answers every method with ErrorResponses::notFound().
+  [[nodiscard]] static const Endpoint& not_found() {
     static const Endpoint not_found_endpoint{
-        "", {}, [](const Request&) {
-          return ResponseBuilder{}
-              .status(StatusCodes::NOT_FOUND)
-              .contentType("application/json")
-              .json({{"error", "Endpoint not found"}})
-              .build();
-        }};
+        "", {}, [](const Request&) { return ErrorResponses::notFound(); }};
+    return not_found_endpoint;
+  }
 
+  [[nodiscard]] const Endpoint& get_endpoint(std::string_view path) const {
     auto it =
         std::find_if(endpoints.begin(), endpoints.end(),
                      [path](const Endpoint& ep) { return ep.path == path; });
 
-    return it != endpoints.end() ? *it : not_found_endpoint;
+    return it != endpoints.end() ? *it : not_found();
+  }
+
+  // The endpoint for path that accepts method. When the path is registered
+  // only for other methods, the first of those is returned; the caller
+  // answers 405.
+  [[nodiscard]] const Endpoint& get_endpoint(std::string_view path,
+                                             HttpMethod method) const {
+    const Endpoint* path_match = nullptr;
+    for (const auto& endpoint : endpoints) {
+      if (endpoint.path != path) {
+        continue;
+      }
+      if (std::ranges::find(endpoint.accepted_methods, method) !=
+          endpoint.accepted_methods.end()) {
+        return endpoint;
+      }
+      if (path_match == nullptr) {
+        path_match = &endpoint;
+      }
+    }
+    return path_match != nullptr ? *path_match : not_found();
+  }
+
+  // Limits requests to path per client; see RateLimiter.
+  void set_rate_limit(std::string_view path, RateLimit limit) {
+    for (auto& endpoint : endpoints) {
+      if (endpoint.path == path) {
+        endpoint.rate_limit = limit;
+      }
+    }
+  }
+
+  [[nodiscard]] bool has_rate_limits() const {
+    return std::any_of(endpoints.begin(), endpoints.end(),
+                       [](const Endpoint& ep) {
+                         return ep.rate_limit && ep.rate_limit->enabled();
+                       });
   }
 
+  [[nodiscard]] bool is_critical(std::string_view path) const {
+    return std::any_of(endpoints.begin(), endpoints.end(),
+                       [path](const Endpoint& ep) {
+                         return ep.path == path &&
+                                ep.priority == Priority::CRITICAL;
+                       });
+  }
+
+  void use(Middleware middleware) { chain.add(std::move(middleware)); }
+
+  [[nodiscard]] const MiddlewareChain& middleware() const { return chain; }
+
   void clear() { endpoints.clear(); }
 
   [[nodiscard]] size_t size() const { return endpoints.size(); }
 
+  // Dense ids for metrics: endpoints are numbered in registration order,
+  // followed by one id for requests no endpoint answered and one for static
+  // files.
+  [[nodiscard]] size_t route_id(const Endpoint& endpoint) const {
+    if (&endpoint == &not_found()) {
+      return unmatched_route();
+    }
+    return static_cast<size_t>(&endpoint - endpoints.data());
+  }
+
+  [[nodiscard]] size_t unmatched_route() const { return endpoints.size(); }
+
+  [[nodiscard]] size_t static_route() const { return endpoints.size() + 1; }
+
+  [[nodiscard]] std::string_view route_label(size_t id) const {
+    if (id < endpoints.size()) {
+      return endpoints[id].path;
+    }
+    return id == unmatched_route() ? "unmatched" : "static";
+  }
+
   [[nodiscard]] bool has_endpoint(std::string_view path) const {
     return std::any_of(endpoints.begin(), endpoints.end(),
                        [path](const Endpoint& ep) { return ep.path == path; });
@@ -75,36 +146,58 @@ class Router {
 
  private:
   std::vector<Endpoint> endpoints;
+  MiddlewareChain chain;
 };
 
 class RouterBuilder {
  public:
   RouterBuilder& add(std::string path, std::vector<HttpMethod> methods,
-                     handler_t handler) {
+                     handler_t handler, Priority priority = Priority::NORMAL) {
     router.add_endpoint(std::move(path), std::move(methods),
-                        std::move(handler));
+                        std::move(handler), priority);
     return *this;
   }
 
-  RouterBuilder& get(std::string path, handler_t handler) {
-    return add(std::move(path), {HttpMethod::GET}, std::move(handler));
+  RouterBuilder& get(std::string path, handler_t handler,
+                     Priority priority = Priority::NORMAL) {
+    return add(std::move(path), {HttpMethod::GET}, std::move(handler),
+               priority);
   }
 
-  RouterBuilder& post(std::string path, handler_t handler) {
-    return add(std::move(path), {HttpMethod::POST}, std::move(handler));
+  RouterBuilder& post(std::string path, handler_t handler,
+                      Priority priority = Priority::NORMAL) {
+    return add(std::move(path), {HttpMethod::POST}, std::move(handler),
+               priority);
   }
 
-  RouterBuilder& put(std::string path, handler_t handler) {
-    return add(std::move(path), {HttpMethod::PUT}, std::move(handler));
+  RouterBuilder& put(std::string path, handler_t handler,
+                     Priority priority = Priority::NORMAL) {
+    return add(std::move(path), {HttpMethod::PUT}, std::move(handler),
+               priority);
   }
 
-  RouterBuilder& del(std::string path, handler_t handler) {
-    return add(std::move(path), {HttpMethod::DELETE}, std::move(handler));
+  RouterBuilder& del(std::string path, handler_t handler,
+                     Priority priority = Priority::NORMAL) {
+    return add(std::move(path), {HttpMethod::DELETE}, std::move(handler),
+               priority);
   }
 
   RouterBuilder& methods(std::string path, std::vector<HttpMethod> methods,
-                         handler_t handler) {
-    return add(std::move(path), std::move(methods), std::move(handler));
+                         handler_t handler,
+                         Priority priority = Priority::NORMAL) {
+    return add(std::move(path), std::move(methods), std::move(handler),
+               priority);
+  }
+
+  // Middleware runs in the order it is added; see Middleware.
+  RouterBuilder& use(Middleware middleware) {
+    router.use(std::move(middleware));
+    return *this;
+  }
+
+  RouterBuilder& rateLimit(std::string_view path, RateLimit limit) {
+    router.set_rate_limit(path, limit);
+    return *this;
   }
 
   Router build() { return std::move(router); }
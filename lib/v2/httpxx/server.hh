@@ -1,9 +1,21 @@
 
 #pragma once
+#include <memory>
+#include <stop_token>
+
+#include "httpxx/access_log.hh"
+#include "httpxx/asset_pack.hh"
 #include "httpxx/configuration.hh"
+#include "httpxx/fd_cache.hh"
+#include "httpxx/flight_recorder.hh"
+#include "httpxx/handoff.hh"
+#include "httpxx/metrics.hh"
+#include "httpxx/perf_counters.hh"
+#include "httpxx/request_handlers.hh"
 #include "httpxx/router.hh"
 #include "httpxx/socket.hh"
 #include "httpxx/socket_enums.hh"
+#include "httpxx/tracing.hh"
 
 namespace httpxx {
 class Server {
@@ -11,6 +23,12 @@ class Server {
   httpxx::Socket socket;
   Router router;
   Config m_config;
+  std::stop_source m_stop_source;
+  std::unique_ptr<ListenerHandoff> m_handoff;
+  std::shared_ptr<Metrics> m_metrics = std::make_shared<Metrics>();
+  std::unique_ptr<AccessLog> m_access_log;
+  std::unique_ptr<Tracer> m_tracer;
+  std::shared_ptr<FlightRecorder> m_flight_recorder;
 
  public:
   explicit Server(const in_port_t port = 8080)
@@ -24,25 +42,159 @@ class Server {
     this->router = std::move(router);
   }
 
+  // Listens on a socket inherited through LISTEN_FDS, one taken over from a
+  // running server on Config::getHandoffSocket(), or a freshly bound one, in
+  // that order.
   explicit Server(Router router, Config config, const std::string& ip_addr = "")
-      : socket(httpxx::Socket(AddressFamilies::af_inet, SocketType::stream,
-                              Protocol::ip)),
-        router(std::move(router)),
-        m_config(std::move(config)) {
-    socket.SetSocketOption(SocketOptions::so_reuseaddr, true);
-    socket.bind_socket(m_config.getPort(), ip_addr);
+      : router(std::move(router)), m_config(std::move(config)) {
+    socket = openListener(ip_addr);
+    applyConfig();
+    addMetricsEndpoint();
+    openAccessLog();
+    openTracer();
+    openFlightRecorder();
   }
 
   explicit Server(Config config, const Router& router,
                   const in_port_t port = 8080)
       : Server(router, port) {
     this->m_config = std::move(config);
+    applyConfig();
+    addMetricsEndpoint();
+    openAccessLog();
+    openTracer();
+    openFlightRecorder();
   }
 
-  void start() const { socket.Listen(router, m_config); }
+  // Serves until stop() is called (or a shutdown signal arrives, see
+  // Config::getHandleSignals()) and every worker has drained.
+  void start() const {
+    m_metrics->setRoutes(router);
+    if (m_tracer) {
+      m_tracer->setRoutes(router);
+    }
+    if (m_flight_recorder) {
+      m_flight_recorder->setRoutes(router);
+    }
+    socket.Listen(router, m_config, SOMAXCONN, m_stop_source, m_handoff.get(),
+                  {.metrics = m_metrics.get(),
+                   .access_log = m_access_log.get(),
+                   .tracer = m_tracer.get(),
+                   .flight_recorder = m_flight_recorder.get()});
+  }
+
+  // Safe to call from any thread. A stopped server cannot be started again.
+  void stop() { m_stop_source.request_stop(); }
 
   httpxx::Socket& getSocket() { return socket; }
 
   void setSocket(const httpxx::Socket& socket) { this->socket = socket; }
+
+  [[nodiscard]] const Metrics& metrics() const { return *m_metrics; }
+
+  // Latency percentiles per route and phase, merged over all workers.
+  [[nodiscard]] std::vector<RouteStats> stats() const {
+    return m_metrics->stats();
+  }
+
+ private:
+  httpxx::Socket openListener(const std::string& ip_addr) {
+    if (auto fds = ListenerHandoff::fromEnvironment(); !fds.empty()) {
+      return adoptListeners(fds);
+    }
+
+    if (!m_config.getHandoffSocket().empty()) {
+      m_handoff =
+          std::make_unique<ListenerHandoff>(m_config.getHandoffSocket());
+      if (auto fds = m_handoff->takeOver()) {
+        std::clog << fmt::format("Took over listener from {}\n",
+                                 m_config.getHandoffSocket().string());
+        return adoptListeners(*fds);
+      }
+    }
+
+    httpxx::Socket fresh(AddressFamilies::af_inet, SocketType::stream,
+                         Protocol::ip);
+    fresh.SetSocketOption(SocketOptions::so_reuseaddr, true);
+    fresh.bind_socket(m_config.getPort(), ip_addr);
+    return fresh;
+  }
+
+  // One listener is served; any further ones are closed.
+  static httpxx::Socket adoptListeners(const std::vector<int>& fds) {
+    for (std::size_t i = 1; i < fds.size(); ++i) {
+      close(fds[i]);
+    }
+    return httpxx::Socket::FromDescriptor(fds.front());
+  }
+
+  // Scrapes are critical so that a server shedding load still reports it.
+  void addMetricsEndpoint() {
+    if (m_config.getMetricsPath().empty()) {
+      return;
+    }
+    router.add_endpoint(
+        m_config.getMetricsPath(), {HttpMethod::GET},
+        [metrics = m_metrics](const Request&) {
+          return ResponseBuilder::ok()
+              .contentType("text/plain; version=0.0.4")
+              .body(metrics->render())
+              .build();
+        },
+        Priority::CRITICAL);
+  }
+
+  void openAccessLog() {
+    if (!m_config.getAccessLog().empty()) {
+      m_access_log = std::make_unique<AccessLog>(
+          m_config.getAccessLog(), m_config.getAccessLogFormat(),
+          m_config.getAccessLogMaxBytes(), m_config.getAccessLogKeep());
+    }
+  }
+
+  void openTracer() {
+    if (!m_config.getTraceExport().empty()) {
+      m_tracer = std::make_unique<Tracer>(m_config.getTraceExport());
+    }
+  }
+
+  // The dump route is critical so that it answers while load is shed, which
+  // is when it is most useful.
+  void openFlightRecorder() {
+    if (m_config.getFlightRecorderSize() == 0) {
+      return;
+    }
+    m_flight_recorder =
+        std::make_shared<FlightRecorder>(m_config.getFlightRecorderSize());
+    if (m_config.getFlightRecorderRoute().empty()) {
+      return;
+    }
+    router.add_endpoint(
+        m_config.getFlightRecorderRoute(), {HttpMethod::GET},
+        [recorder = m_flight_recorder](const Request&) {
+          return ResponseBuilder::ok()
+              .contentType("text/tab-separated-values")
+              .body(recorder->dump())
+              .build();
+        },
+        Priority::CRITICAL);
+  }
+
+  void applyConfig() const {
+    if (m_config.getPerfCounterSampleRate() > 0 && !perf_counters_compiled) {
+      std::clog << "[httpx::Server] perf_counter_sample_rate is ignored: "
+                   "built without HTTPXX_PERF_COUNTERS\n";
+    }
+    FdCache::global().setCapacity(m_config.getFdCacheCapacity());
+    FdCache::global().setRevalidateInterval(
+        m_config.getFdCacheRevalidateInterval());
+
+    if (!m_config.getAssetPack().empty()) {
+      auto pack = AssetPack::open(m_config.getAssetPack());
+      std::clog << fmt::format("Mounted asset pack {} ({} files)\n",
+                               m_config.getAssetPack().string(), pack->size());
+      FileServer::mountAssetPack(std::move(pack));
+    }
+  }
 };
 }  // namespace httpxx
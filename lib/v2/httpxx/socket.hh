@@ -2,22 +2,31 @@
 #pragma once
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <strings.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include <cassert>
 #include <cerrno>
+#include <csignal>
 #include <chrono>
 #include <cstddef>
 #include <cstring>
 #include <exception>
 #include <iostream>
 #include <stdexcept>
+#include <stop_token>
 #include <string_view>
 #include <thread>
+#include <vector>
 
+#include "httpxx/client_address.hh"
 #include "httpxx/configuration.hh"
+#include "httpxx/event_loop.hh"
+#include "httpxx/handoff.hh"
+#include "httpxx/metrics.hh"
 #include "httpxx/request_handlers.hh"
 #include "httpxx/router.hh"
 #include "httpxx/socket_enums.hh"
@@ -55,6 +64,17 @@ inline void handle_socket_error(const std::string& prefix) {
   }
 }
 
+// Optional sinks that Socket::Listen feeds; a null one is skipped. Each
+// worker counts into a block of its own in metrics, logs requests and exports
+// sampled traces through rings of its own in access_log and tracer, and keeps
+// its recent requests in flight_recorder.
+struct ListenSinks {
+  Metrics* metrics{nullptr};
+  AccessLog* access_log{nullptr};
+  Tracer* tracer{nullptr};
+  FlightRecorder* flight_recorder{nullptr};
+};
+
 class Socket {
   using SocketOptionValue = const int;
   using Port = in_port_t;
@@ -72,12 +92,19 @@ class Socket {
   auto SetSocketOption(SocketOptions option, SocketOptionValue option_value)
       -> Socket*;
 
-  [[nodiscard]] auto Accept() const -> int;
+  [[nodiscard]] auto Accept(ClientAddress* client = nullptr) const -> int;
 
   static auto Write(const int client_fd, const std::string& message) -> void;
 
   auto Listen(const httpxx::Router& router, const httpxx::Config& config,
-              const int max_queued_connections = SOMAXCONN) const -> void;
+              const int max_queued_connections = SOMAXCONN,
+              std::stop_source stop = std::stop_source(),
+              ListenerHandoff* handoff = nullptr,
+              ListenSinks sinks = {}) const -> void;
+
+  // Wraps an already bound socket, e.g. one inherited from systemd or taken
+  // over from a previous process.
+  static auto FromDescriptor(int fd) -> Socket;
 
   Socket() = default;
 
@@ -123,17 +150,20 @@ inline auto Socket::SetSocketOption(SocketOptions option,
   return this;
 }
 
-[[nodiscard]] inline auto Socket::Accept() const -> int {
-  struct sockaddr_in client_addr{};
-  int client_addr_len = sizeof(client_addr);
+[[nodiscard]] inline auto Socket::Accept(ClientAddress* client) const -> int {
+  struct sockaddr_storage client_addr{};
+  socklen_t client_addr_len = sizeof(client_addr);
   const int client_fd =
       accept(_fd, reinterpret_cast<struct sockaddr*>(&client_addr),
-             reinterpret_cast<socklen_t*>(&client_addr_len));
+             &client_addr_len);
 
   if (client_fd == -1) {
     handle_socket_error("[httpx::Socket::Accept]");
   }
 
+  if (client != nullptr) {
+    *client = ClientAddress::from(client_addr);
+  }
   return client_fd;
 }
 
@@ -145,31 +175,106 @@ inline auto Socket::Write(const int client_fd, const std::string& message)
   close(client_fd);
 }
 
+// Runs config.getWorkers() event loops until stop is requested or, when
+// config.getHandleSignals() is set, SIGTERM or SIGINT arrives, then returns
+// once they have drained. The signals are blocked for the calling thread and
+// the workers and read through a signalfd; threads started earlier must
+// block them too, see startBackgroundThread(). With a handoff, the previous
+// process is released once this one accepts, and later processes can take
+// the listener over in turn. With a flight recorder in sinks and a dump file
+// configured, SIGUSR1 writes the recorder to it, whether or not the shutdown
+// signals are handled.
 inline auto Socket::Listen(const httpxx::Router& router,
                            const httpxx::Config& config,
-                           const int max_queued_connections) const -> void {
+                           const int max_queued_connections,
+                           std::stop_source stop,
+                           ListenerHandoff* handoff,
+                           ListenSinks sinks) const -> void {
   if (listen(_fd, max_queued_connections) != 0) {
     throw httpxSocketException(
         "[httpx::Socket::Listen] Failed to initialize listening.");
   }
 
-  while (true) {
-    int client_fd = Accept();
-    if (client_fd < 0) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      continue;
-    }
+  // Peers that disconnect mid-response must not kill the process.
+  std::signal(SIGPIPE, SIG_IGN);
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+
+  sigset_t signals{};
+  sigset_t previous_mask{};
+  int signal_fd = -1;
+  sigemptyset(&signals);
+  if (config.getHandleSignals()) {
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+  }
+  if (sinks.flight_recorder != nullptr &&
+      !config.getFlightRecorderDump().empty()) {
+    sigaddset(&signals, SIGUSR1);
+  }
+  if (!sigisemptyset(&signals)) {
+    pthread_sigmask(SIG_BLOCK, &signals, &previous_mask);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  }
 
-    char buffer[4096];
-    bzero(&buffer, 4096);
-    if (read(client_fd, &buffer, 4096) == -1) {
-      close(client_fd);
-      continue;
+  const std::size_t workers = config.getWorkers();
+  std::clog << "Starting " << workers << " worker(s)" << std::endl;
+
+  SharedListener listener(_fd, workers);
+  RateLimiter limiter;
+  Metrics unreported;
+  if (sinks.metrics == nullptr) {
+    sinks.metrics = &unreported;
+  }
+  {
+    const auto attach = [](auto* sink) {
+      return sink != nullptr ? &sink->attach() : nullptr;
+    };
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 1; i < workers; ++i) {
+      threads.emplace_back([&router, &config, &listener, &limiter,
+                            &counters = sinks.metrics->addWorker(),
+                            log = attach(sinks.access_log),
+                            traces = attach(sinks.tracer),
+                            flight = attach(sinks.flight_recorder), stop] {
+        EventLoop(router, config, listener, limiter, counters, log, traces,
+                  flight, stop)
+            .run();
+      });
     }
-    std::jthread{&httpxx::RequestHandler::handle, router, config, client_fd,
-                 buffer};
+    try {
+      EventLoop loop(router, config, listener, limiter,
+                     sinks.metrics->addWorker(), attach(sinks.access_log),
+                     attach(sinks.tracer), attach(sinks.flight_recorder), stop,
+                     signal_fd);
+      if (sinks.flight_recorder != nullptr) {
+        loop.watchFlightRecorder(*sinks.flight_recorder,
+                                 config.getFlightRecorderDump());
+      }
+      if (handoff != nullptr) {
+        handoff->ready();
+        loop.watchHandoff(*handoff);
+      }
+      loop.run();
+    } catch (...) {
+      stop.request_stop();
+      throw;
+    }
+  }
+
+  if (signal_fd != -1) {
+    close(signal_fd);
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
   }
+  std::clog << "Server stopped" << std::endl;
+}
+
+inline auto Socket::FromDescriptor(int fd) -> Socket {
+  Socket socket;
+  socket._fd = fd;
+  std::clog << "Using inherited listening socket, _fd: " << fd << std::endl;
+  return socket;
 }
+
 [[nodiscard]] inline int Socket::init_socket(
     AddressFamilies domain, SocketType type,
     Protocol protocol) noexcept(false) {
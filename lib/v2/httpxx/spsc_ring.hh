@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+
+namespace httpxx {
+
+// Bounded queue between one producer and one consumer thread. Each side owns
+// its index and only reads the other's with acquire, so neither takes a lock
+// or issues a read-modify-write.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+  static_assert(std::has_single_bit(Capacity));
+
+ public:
+  SpscRing() : slots_(std::make_unique<T[]>(Capacity)) {}
+
+  // Producer side: fill receives the free slot to write into. Returns false,
+  // without calling fill, when the ring is full.
+  template <typename Fill>
+  bool tryPush(Fill&& fill) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ == Capacity) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ == Capacity) {
+        return false;
+      }
+    }
+    fill(slots_[head & (Capacity - 1)]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: hands every queued element to consume, oldest first.
+  template <typename Consume>
+  std::size_t drain(Consume&& consume) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    const auto head = head_.load(std::memory_order_acquire);
+    const auto count = head - tail;
+    for (; tail != head; ++tail) {
+      consume(slots_[tail & (Capacity - 1)]);
+    }
+    tail_.store(tail, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t cached_tail_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::unique_ptr<T[]> slots_;
+};
+
+}  // namespace httpxx
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace httpxx {
+
+// Intrusive timer entry, embedded in whatever it times out. data is free for
+// the owner, e.g. a packed ConnectionHandle.
+struct TimerNode {
+  TimerNode* prev{nullptr};
+  TimerNode* next{nullptr};
+  uint64_t expires{0};
+  uint64_t data{0};
+
+  [[nodiscard]] bool armed() const { return next != nullptr; }
+};
+
+// Hierarchical hashed timer wheel: levels of 64 slots, each level 64 times
+// coarser than the one below, with a 10 ms tick, covering about 46 hours.
+// Timers are intrusive list nodes, so scheduling, cancelling and expiring are
+// O(1) and arming millions of them allocates nothing. Timers in outer levels
+// are cascaded inwards as the wheel turns. Not thread-safe: one per worker.
+class TimerWheel {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds tick{10};
+  static constexpr std::size_t slot_bits = 6;
+  static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+  static constexpr std::size_t level_count = 4;
+  static constexpr uint64_t max_ticks =
+      (uint64_t{1} << (slot_bits * level_count)) - 1;
+
+  explicit TimerWheel(clock::time_point now = clock::now()) : start_(now) {
+    for (auto& level : wheel_) {
+      for (auto& head : level) {
+        head.prev = head.next = &head;
+      }
+    }
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Arms node to fire after delay. The delay is rounded up to whole ticks
+  // plus the partly elapsed current one, so a timer never fires early. A node
+  // that is already armed is moved.
+  void schedule(TimerNode& node, clock::duration delay) {
+    cancel(node);
+    const auto ticks = static_cast<uint64_t>(
+        std::max<int64_t>(0, (delay + tick - clock::duration(1)) / tick));
+    node.expires = current_ + std::min(ticks + 1, max_ticks);
+    place(node);
+    ++size_;
+  }
+
+  void cancel(TimerNode& node) {
+    if (node.armed()) {
+      unlink(node);
+      --size_;
+    }
+  }
+
+  // Fires every timer due at or before now. on_expired(TimerNode&) runs after
+  // the node is unlinked and may re-arm it or cancel other timers.
+  template <typename Fn>
+  void advance(clock::time_point now, Fn&& on_expired) {
+    const uint64_t target = ticksAt(now);
+    if (size_ == 0) {
+      current_ = std::max(current_, target);
+      return;
+    }
+
+    while (current_ < target) {
+      ++current_;
+      cascade();
+
+      TimerNode& head = wheel_[0][current_ & (slot_count - 1)];
+      while (head.next != &head) {
+        TimerNode& node = *head.next;
+        unlink(node);
+        --size_;
+        on_expired(node);
+      }
+    }
+  }
+
+  // Milliseconds until the wheel next needs to advance, for epoll_wait();
+  // -1 when no timer is armed.
+  [[nodiscard]] int nextTimeout(clock::time_point now) const {
+    if (size_ == 0) {
+      return -1;
+    }
+
+    uint64_t due = current_ + 1;
+    while ((due & (slot_count - 1)) != 0 &&
+           wheel_[0][due & (slot_count - 1)].next ==
+               &wheel_[0][due & (slot_count - 1)]) {
+      ++due;
+    }
+
+    const auto at = start_ + due * tick;
+    const auto wait =
+        std::chrono::ceil<std::chrono::milliseconds>(at - now).count();
+    return static_cast<int>(std::max<int64_t>(0, wait));
+  }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+ private:
+  std::array<std::array<TimerNode, slot_count>, level_count> wheel_{};
+  clock::time_point start_;
+  uint64_t current_{0};
+  std::size_t size_{0};
+
+  [[nodiscard]] uint64_t ticksAt(clock::time_point now) const {
+    return static_cast<uint64_t>(std::max<int64_t>(0, (now - start_) / tick));
+  }
+
+  void place(TimerNode& node) {
+    const uint64_t expires = std::max(node.expires, current_);
+    const uint64_t delta = expires - current_;
+
+    std::size_t level = 0;
+    while (level + 1 < level_count &&
+           delta >= (uint64_t{1} << (slot_bits * (level + 1)))) {
+      ++level;
+    }
+
+    const auto index = (expires >> (slot_bits * level)) & (slot_count - 1);
+    TimerNode& head = wheel_[level][index];
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+  }
+
+  static void unlink(TimerNode& node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+  }
+
+  // When a level wraps, the next slot of the level above is redistributed
+  // into the finer levels.
+  void cascade() {
+    for (std::size_t level = 1; level < level_count; ++level) {
+      const uint64_t low_mask = (uint64_t{1} << (slot_bits * level)) - 1;
+      if ((current_ & low_mask) != 0) {
+        return;
+      }
+
+      const auto index = (current_ >> (slot_bits * level)) & (slot_count - 1);
+      TimerNode& head = wheel_[level][index];
+      while (head.next != &head) {
+        TimerNode& node = *head.next;
+        unlink(node);
+        place(node);
+      }
+    }
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "httpxx/background_thread.hh"
+#include "httpxx/json_escape.hh"
+#include "httpxx/metrics.hh"
+#include "httpxx/router.hh"
+#include "httpxx/spsc_ring.hh"
+
+namespace httpxx {
+
+using TraceId = std::array<uint8_t, 16>;
+using SpanId = std::array<uint8_t, 8>;
+
+// W3C trace context, as carried by the traceparent header.
+struct TraceContext {
+  TraceId trace_id{};
+  SpanId parent_id{};
+  uint8_t flags{0};
+
+  [[nodiscard]] bool sampled() const { return (flags & 1) != 0; }
+
+  // Accepts version 00 and, as the specification asks, later versions as
+  // long as they start with the fields of version 00.
+  static std::optional<TraceContext> parse(std::string_view header) {
+    constexpr std::size_t length = 55;
+    if (header.size() < length || header[2] != '-' || header[35] != '-' ||
+        header[52] != '-' ||
+        (header.size() > length && header[length] != '-')) {
+      return std::nullopt;
+    }
+    std::array<uint8_t, 1> version{};
+    TraceContext context;
+    std::array<uint8_t, 1> flags{};
+    if (!decodeHex(header.substr(0, 2), version) || version[0] == 0xff ||
+        (version[0] == 0 && header.size() != length) ||
+        !decodeHex(header.substr(3, 32), context.trace_id) ||
+        !decodeHex(header.substr(36, 16), context.parent_id) ||
+        !decodeHex(header.substr(53, 2), flags) ||
+        context.trace_id == TraceId{} || context.parent_id == SpanId{}) {
+      return std::nullopt;
+    }
+    context.flags = flags[0];
+    return context;
+  }
+
+ private:
+  static bool decodeHex(std::string_view text, std::span<uint8_t> out) {
+    const auto digit = [](char c) -> int {
+      if (c >= '0' && c <= '9') return c - '0';
+      if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+      return -1;
+    };
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      const int high = digit(text[2 * i]);
+      const int low = digit(text[2 * i + 1]);
+      if (high < 0 || low < 0) {
+        return false;
+      }
+      out[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+  }
+};
+
+// A request picked for tracing, from the sampling decision until its
+// response is written. The context names the trace the request joins.
+struct SampledTrace {
+  TraceContext context;
+  bool has_parent{false};
+  HttpMethod method{};
+};
+
+// Everything the exporter needs for the spans of one request: a server span
+// covering the request and one child per phase of it. Times are Unix
+// nanoseconds: received, parsed, routed, handled and written.
+struct TraceRecord {
+  SampledTrace trace;
+  std::array<SpanId, phase_count> span_ids;
+  std::array<int64_t, 5> times;
+  std::size_t route;
+  uint16_t status;
+};
+
+// Head-based sampling, decided per worker before a request is parsed. A
+// request that carries a traceparent follows its caller's decision; any
+// other starts a new trace with probability rate. An unsampled request costs
+// a header lookup and, with a non-zero rate, one random number.
+class TraceSampler {
+ public:
+  explicit TraceSampler(double rate)
+      : state_((uint64_t{std::random_device{}()} << 32) ^
+               std::random_device{}()),
+        threshold_(threshold(rate)) {}
+
+  [[nodiscard]] std::optional<SampledTrace> decide(
+      std::optional<std::string_view> traceparent) {
+    if (traceparent) {
+      if (const auto parent = TraceContext::parse(*traceparent)) {
+        if (!parent->sampled()) {
+          return std::nullopt;
+        }
+        return SampledTrace{.context = *parent, .has_parent = true};
+      }
+    }
+    if (threshold_ == 0 || next() >= threshold_) {
+      return std::nullopt;
+    }
+    SampledTrace trace;
+    fill(trace.context.trace_id);
+    trace.context.flags = 1;
+    return trace;
+  }
+
+  template <std::size_t N>
+  void fill(std::array<uint8_t, N>& id) {
+    for (std::size_t i = 0; i < N; i += sizeof(uint64_t)) {
+      const auto bits = next() | 1;
+      std::memcpy(id.data() + i, &bits, std::min(sizeof(bits), N - i));
+    }
+  }
+
+ private:
+  uint64_t state_;
+  uint64_t threshold_;
+
+  static uint64_t threshold(double rate) {
+    if (rate <= 0) {
+      return 0;
+    }
+    if (rate >= 1) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(
+        rate * static_cast<double>(std::numeric_limits<uint64_t>::max()));
+  }
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+};
+
+// Exports sampled requests as OTLP/JSON, one ExportTraceServiceRequest per
+// line, to a file or, for a destination of the form unix:/path, to a
+// collector listening on a Unix stream socket. Workers push TraceRecords
+// into rings of their own from attach(); a background thread drains them
+// every flush_interval. Records that do not fit are dropped and counted by
+// the worker. A collector that is unreachable loses the batch, and the
+// exporter reconnects on the next one.
+class Tracer {
+ public:
+  static constexpr std::size_t ring_capacity = 1024;
+  static constexpr std::chrono::milliseconds flush_interval{100};
+
+  using Ring = SpscRing<TraceRecord, ring_capacity>;
+
+  explicit Tracer(std::string destination) {
+    constexpr std::string_view unix_prefix = "unix:";
+    if (destination.starts_with(unix_prefix)) {
+      socket_path_ = destination.substr(unix_prefix.size());
+    } else {
+      fd_ = ::open(destination.c_str(),
+                   O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+      if (fd_ == -1) {
+        throw std::runtime_error(
+            fmt::format("[httpx::Tracer] Cannot open {}: {}", destination,
+                        std::strerror(errno)));
+      }
+    }
+    thread_ = startBackgroundThread(
+        [this](std::stop_token stop) { run(stop); });
+  }
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  ~Tracer() {
+    thread_.request_stop();
+    thread_.join();
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  // Names spans after the router's paths. Call before any worker attaches.
+  void setRoutes(const Router& router) {
+    std::lock_guard lock(mutex_);
+    routes_.clear();
+    for (std::size_t id = 0; id <= router.static_route(); ++id) {
+      routes_.emplace_back(router.route_label(id));
+    }
+  }
+
+  [[nodiscard]] Ring& attach() {
+    std::lock_guard lock(mutex_);
+    rings_.push_back(std::make_unique<Ring>());
+    return *rings_.back();
+  }
+
+ private:
+  std::string socket_path_;
+  int fd_{-1};
+  fmt::memory_buffer out_;
+  std::vector<std::string> routes_;
+  std::mutex mutex_;
+  std::condition_variable_any wake_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::jthread thread_;
+
+  void run(std::stop_token stop) {
+    std::vector<Ring*> rings;
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait_for(lock, stop, flush_interval, [] { return false; });
+        rings.clear();
+        for (const auto& ring : rings_) {
+          rings.push_back(ring.get());
+        }
+      }
+      bool first = true;
+      for (auto* ring : rings) {
+        ring->drain([this, &first](const TraceRecord& record) {
+          if (first) {
+            beginBatch();
+            first = false;
+          } else {
+            out_.push_back(',');
+          }
+          appendSpans(record);
+        });
+      }
+      if (!first) {
+        endBatch();
+        flush();
+      }
+      if (stop.stop_requested()) {
+        return;
+      }
+    }
+  }
+
+  void beginBatch() {
+    out_.append(std::string_view(
+        R"({"resourceSpans":[{"resource":{"attributes":[{"key":)"
+        R"("service.name","value":{"stringValue":"httpxx"}}]},)"
+        R"("scopeSpans":[{"scope":{"name":"httpxx"},"spans":[)"));
+  }
+
+  void endBatch() { out_.append(std::string_view("]}]}]}\n")); }
+
+  void appendSpans(const TraceRecord& record) {
+    auto it = std::back_inserter(out_);
+    const auto& trace = record.trace;
+    const auto& root =
+        record.span_ids[static_cast<std::size_t>(Phase::TOTAL)];
+    const auto method = +trace.method;
+    const std::string_view route = record.route < routes_.size()
+                                       ? std::string_view(routes_[record.route])
+                                       : "unmatched";
+
+    fmt::format_to(it, R"({{"traceId":"{}","spanId":"{}",)",
+                   hex(trace.context.trace_id), hex(root));
+    if (trace.has_parent) {
+      fmt::format_to(it, R"("parentSpanId":"{}",)",
+                     hex(trace.context.parent_id));
+    }
+    fmt::format_to(it, R"("name":")");
+    appendJsonEscaped(out_, method);
+    out_.push_back(' ');
+    appendJsonEscaped(out_, route);
+    fmt::format_to(it,
+                   R"(","kind":2,"startTimeUnixNano":"{}",)"
+                   R"("endTimeUnixNano":"{}","attributes":[)"
+                   R"({{"key":"http.request.method","value":{{"stringValue":")",
+                   record.times.front(), record.times.back());
+    appendJsonEscaped(out_, method);
+    fmt::format_to(
+        it, R"("}}}},{{"key":"http.route","value":{{"stringValue":")");
+    appendJsonEscaped(out_, route);
+    fmt::format_to(it,
+                   R"("}}}},{{"key":"http.response.status_code","value":)"
+                   R"({{"intValue":"{}"}}}}]{}}})",
+                   record.status,
+                   record.status >= 500 ? R"(,"status":{"code":2})" : "");
+
+    for (std::size_t phase = 0; phase + 1 < phase_count; ++phase) {
+      fmt::format_to(it,
+                     R"(,{{"traceId":"{}","spanId":"{}","parentSpanId":"{}",)"
+                     R"("name":"{}","kind":1,"startTimeUnixNano":"{}",)"
+                     R"("endTimeUnixNano":"{}"}})",
+                     hex(trace.context.trace_id), hex(record.span_ids[phase]),
+                     hex(root), phase_names[phase], record.times[phase],
+                     record.times[phase + 1]);
+    }
+  }
+
+  template <std::size_t N>
+  static std::string hex(const std::array<uint8_t, N>& id) {
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::string text(2 * N, '0');
+    for (std::size_t i = 0; i < N; ++i) {
+      text[2 * i] = digits[id[i] >> 4];
+      text[2 * i + 1] = digits[id[i] & 0xf];
+    }
+    return text;
+  }
+
+  void flush() {
+    if (fd_ == -1 && !socket_path_.empty()) {
+      connectCollector();
+    }
+    std::string_view pending(out_.data(), out_.size());
+    while (fd_ != -1 && !pending.empty()) {
+      const auto written =
+          socket_path_.empty()
+              ? ::write(fd_, pending.data(), pending.size())
+              : ::send(fd_, pending.data(), pending.size(), MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        std::clog << fmt::format("[httpx::Tracer] export: {}\n",
+                                 std::strerror(errno));
+        if (!socket_path_.empty()) {
+          ::close(fd_);
+          fd_ = -1;
+        }
+        break;
+      }
+      pending.remove_prefix(static_cast<std::size_t>(written));
+    }
+    out_.clear();
+  }
+
+  void connectCollector() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(address.sun_path)) {
+      return;
+    }
+    std::memcpy(address.sun_path, socket_path_.data(), socket_path_.size());
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ != -1 && ::connect(fd_, reinterpret_cast<sockaddr*>(&address),
+                               sizeof(address)) == -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+};
+
+}  // namespace httpxx
@@ -0,0 +1,651 @@
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <httpxx/histogram.hh>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// HTTP/1.1 load generator for httpxx servers on the same machine.
+//
+// Closed loop: every connection keeps --pipeline requests in flight and sends
+// the next one as soon as a response arrives, so the server sets the pace.
+// Open loop: requests are due at a constant --rate regardless of how fast the
+// server answers. A request that cannot be sent on time waits in a backlog,
+// and its latency is measured from when it was due rather than from when it
+// was sent, which corrects for coordinated omission.
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string host{"127.0.0.1"};
+  std::string port{"6969"};
+  std::string scenario{"tasks"};
+  std::size_t connections{16};
+  std::size_t pipeline{1};
+  std::size_t threads{1};
+  double rate{0};
+  std::chrono::milliseconds duration{10'000};
+  std::chrono::milliseconds warmup{2'000};
+  bool histogram{false};
+};
+
+constexpr std::string_view usage =
+    "usage: httpxx-bench [options]\n"
+    "  --target HOST:PORT   server to load (default 127.0.0.1:6969)\n"
+    "  --scenario NAME      tasks, tasks-create, static or spa (default "
+    "tasks)\n"
+    "  --connections N      keep-alive connections (default 16)\n"
+    "  --pipeline N         requests in flight per connection (default 1)\n"
+    "  --threads N          client threads (default 1)\n"
+    "  --rate R             open loop at R requests/s in total; 0 runs a\n"
+    "                       closed loop (default 0)\n"
+    "  --duration S         seconds measured (default 10)\n"
+    "  --warmup S           seconds run before measuring (default 2)\n"
+    "  --histogram          print the full latency distribution\n"
+    "\n"
+    "The scenarios drive the example app in example/:\n"
+    "  tasks         GET /api/tasks\n"
+    "  tasks-create  POST /api/tasks with a JSON body\n"
+    "  static        GET of the files under example/static\n"
+    "  spa           a page load: /, its stylesheet and script, "
+    "/api/tasks\n"
+    "\n"
+    "With HTTPXX_BENCH_JSON set, the summary is appended to that file as a\n"
+    "line of JSON.\n";
+
+std::string get(std::string_view path, std::string_view host) {
+  return fmt::format(
+      "GET {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: httpxx-bench\r\n"
+      "Accept: */*\r\n\r\n",
+      path, host);
+}
+
+std::string post(std::string_view path, std::string_view host,
+                 std::string_view json) {
+  return fmt::format(
+      "POST {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: httpxx-bench\r\n"
+      "Content-Type: application/json\r\nContent-Length: {}\r\n\r\n{}",
+      path, host, json.size(), json);
+}
+
+// Requests a connection sends in turn, serialised once up front.
+std::vector<std::string> scenarioRequests(std::string_view name,
+                                          std::string_view host) {
+  if (name == "tasks") {
+    return {get("/api/tasks", host)};
+  }
+  if (name == "tasks-create") {
+    return {post("/api/tasks", host,
+                 R"({"title":"benchmark","description":"created by )"
+                 R"(httpxx-bench","tags":["bench"]})")};
+  }
+  if (name == "static") {
+    return {get("/index.html", host), get("/css/style.css", host),
+            get("/js/index.js", host), get("/assets/about.html", host)};
+  }
+  if (name == "spa") {
+    return {get("/", host), get("/css/style.css", host),
+            get("/js/index.js", host), get("/api/tasks", host)};
+  }
+  throw std::invalid_argument(fmt::format("unknown scenario '{}'", name));
+}
+
+std::chrono::milliseconds seconds(std::string_view value) {
+  return std::chrono::milliseconds(
+      static_cast<int64_t>(std::stod(std::string(value)) * 1000));
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view flag = argv[i];
+    if (flag == "--help" || flag == "-h") {
+      std::cout << usage;
+      std::exit(0);
+    }
+    if (flag == "--histogram") {
+      options.histogram = true;
+      continue;
+    }
+    if (i + 1 == argc) {
+      throw std::invalid_argument(fmt::format("{} needs a value", flag));
+    }
+    const std::string_view value = argv[++i];
+    if (flag == "--target") {
+      const auto colon = value.rfind(':');
+      if (colon == value.npos) {
+        throw std::invalid_argument("--target must be HOST:PORT");
+      }
+      options.host = value.substr(0, colon);
+      options.port = value.substr(colon + 1);
+    } else if (flag == "--scenario") {
+      options.scenario = value;
+    } else if (flag == "--connections") {
+      options.connections = std::stoul(std::string(value));
+    } else if (flag == "--pipeline") {
+      options.pipeline = std::stoul(std::string(value));
+    } else if (flag == "--threads") {
+      options.threads = std::stoul(std::string(value));
+    } else if (flag == "--rate") {
+      options.rate = std::stod(std::string(value));
+    } else if (flag == "--duration") {
+      options.duration = seconds(value);
+    } else if (flag == "--warmup") {
+      options.warmup = seconds(value);
+    } else {
+      throw std::invalid_argument(fmt::format("unknown option {}", flag));
+    }
+  }
+  if (options.connections == 0 || options.pipeline == 0 ||
+      options.threads == 0 || options.threads > options.connections) {
+    throw std::invalid_argument(
+        "--connections, --pipeline and --threads must be positive, with no "
+        "more threads than connections");
+  }
+  return options;
+}
+
+sockaddr_storage resolve(const Options& options, socklen_t& length) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* result = nullptr;
+  if (const int error = ::getaddrinfo(options.host.c_str(),
+                                      options.port.c_str(), &hints, &result)) {
+    throw std::runtime_error(fmt::format("cannot resolve {}:{}: {}",
+                                         options.host, options.port,
+                                         ::gai_strerror(error)));
+  }
+  sockaddr_storage address{};
+  std::memcpy(&address, result->ai_addr, result->ai_addrlen);
+  length = result->ai_addrlen;
+  ::freeaddrinfo(result);
+  return address;
+}
+
+bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+  return std::ranges::equal(lhs, rhs, [](char a, char b) {
+    return std::tolower(static_cast<unsigned char>(a)) ==
+           std::tolower(static_cast<unsigned char>(b));
+  });
+}
+
+// What a response head says about the bytes that follow it.
+struct ResponseHead {
+  int status{0};
+  std::size_t content_length{0};
+  bool close{false};
+};
+
+ResponseHead parseHead(std::string_view head) {
+  ResponseHead parsed;
+  if (head.size() > 12) {
+    std::from_chars(head.data() + 9, head.data() + 12, parsed.status);
+  }
+  while (!head.empty()) {
+    const auto end = head.find("\r\n");
+    const auto line = head.substr(0, end);
+    head.remove_prefix(end == head.npos ? head.size() : end + 2);
+
+    const auto colon = line.find(':');
+    if (colon == line.npos) {
+      continue;
+    }
+    const auto name = line.substr(0, colon);
+    auto value = line.substr(colon + 1);
+    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+    if (equalsIgnoreCase(name, "content-length")) {
+      std::from_chars(value.data(), value.data() + value.size(),
+                      parsed.content_length);
+    } else if (equalsIgnoreCase(name, "connection")) {
+      parsed.close = equalsIgnoreCase(value, "close");
+    }
+  }
+  return parsed;
+}
+
+struct Totals {
+  uint64_t responses{0};
+  uint64_t non_2xx{0};
+  uint64_t errors{0};
+  uint64_t reconnects{0};
+};
+
+// One client thread and its share of the connections, driven by epoll. In
+// open loop a timerfd wakes the thread when the next request is due.
+class Worker {
+ public:
+  Worker(const Options& options, const std::vector<std::string>& requests,
+         const sockaddr_storage& address, socklen_t address_length,
+         std::size_t connections, double rate)
+      : options_(options),
+        requests_(requests),
+        address_(address),
+        address_length_(address_length),
+        connections_(connections),
+        interval_(rate > 0 ? std::chrono::duration_cast<clock::duration>(
+                                 std::chrono::duration<double>(1.0 / rate))
+                           : clock::duration::zero()) {
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (interval_ != clock::duration::zero()) {
+      timer_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      epoll_event event{.events = EPOLLIN, .data = {.u64 = timer_id}};
+      ::epoll_ctl(epoll_, EPOLL_CTL_ADD, timer_, &event);
+    }
+    for (std::size_t i = 0; i < connections_.size(); ++i) {
+      connect(i);
+    }
+  }
+
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+  ~Worker() {
+    for (auto& connection : connections_) {
+      if (connection.fd != -1) {
+        ::close(connection.fd);
+      }
+    }
+    if (timer_ != -1) {
+      ::close(timer_);
+    }
+    ::close(epoll_);
+  }
+
+  void run(clock::time_point start, clock::time_point measure_from,
+           clock::time_point until) {
+    measure_from_ = measure_from;
+    until_ = until;
+    next_due_ = start;
+
+    std::array<epoll_event, 64> events;
+    auto now = clock::now();
+    while (now < until_) {
+      if (interval_ != clock::duration::zero()) {
+        for (; next_due_ <= now; next_due_ += interval_) {
+          backlog_.push_back(next_due_);
+        }
+        armTimer(std::min(next_due_, until_));
+      }
+      for (std::size_t i = 0; i < connections_.size(); ++i) {
+        fill(i, now);
+      }
+
+      const auto wait = std::chrono::ceil<std::chrono::milliseconds>(until_ -
+                                                                      now);
+      const int ready = ::epoll_wait(epoll_, events.data(), events.size(),
+                                     static_cast<int>(wait.count()));
+      now = clock::now();
+      for (int e = 0; e < ready; ++e) {
+        const auto id = events[e].data.u64;
+        if (id == timer_id) {
+          uint64_t expirations;
+          [[maybe_unused]] auto ignored =
+              ::read(timer_, &expirations, sizeof(expirations));
+          continue;
+        }
+        if (events[e].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+          receive(id, now);
+        }
+        if (events[e].events & EPOLLOUT) {
+          flush(id);
+        }
+      }
+    }
+  }
+
+  void collect(httpxx::HistogramSnapshot& latency, Totals& totals) const {
+    histogram_.snapshotInto(latency);
+    totals.responses += totals_.responses;
+    totals.non_2xx += totals_.non_2xx;
+    totals.errors += totals_.errors;
+    totals.reconnects += totals_.reconnects;
+  }
+
+ private:
+  static constexpr uint64_t timer_id = ~uint64_t{0};
+
+  struct Connection {
+    int fd{-1};
+    std::string out;
+    std::size_t out_sent{0};
+    bool want_write{false};
+    std::string in;
+    std::size_t in_parsed{0};
+    // When each request in flight started counting, oldest first.
+    std::deque<clock::time_point> started;
+    std::size_t next_request{0};
+  };
+
+  const Options& options_;
+  const std::vector<std::string>& requests_;
+  sockaddr_storage address_;
+  socklen_t address_length_;
+  std::vector<Connection> connections_;
+  clock::duration interval_;
+  int epoll_{-1};
+  int timer_{-1};
+  clock::time_point measure_from_;
+  clock::time_point until_;
+  clock::time_point next_due_;
+  std::deque<clock::time_point> backlog_;
+  httpxx::Histogram histogram_;
+  Totals totals_;
+
+  void connect(std::size_t id) {
+    auto& connection = connections_[id];
+    const int fd = ::socket(address_.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 ||
+        ::connect(fd, reinterpret_cast<const sockaddr*>(&address_),
+                  address_length_) == -1) {
+      throw std::runtime_error(fmt::format("cannot connect to {}:{}: {}",
+                                           options_.host, options_.port,
+                                           std::strerror(errno)));
+    }
+    const int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    connection.fd = fd;
+    connection.want_write = false;
+    epoll_event event{.events = EPOLLIN, .data = {.u64 = id}};
+    ::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  // Requests in flight on a connection the server closed are lost and count
+  // as errors; the connection is opened again.
+  void reconnect(std::size_t id) {
+    auto& connection = connections_[id];
+    totals_.errors += connection.started.size();
+    ++totals_.reconnects;
+    ::close(connection.fd);
+    const auto next_request = connection.next_request;
+    connection = Connection{};
+    connection.next_request = next_request;
+    connect(id);
+  }
+
+  void fill(std::size_t id, clock::time_point now) {
+    auto& connection = connections_[id];
+    const bool open_loop = interval_ != clock::duration::zero();
+    const auto queued = connection.started.size();
+    while (connection.started.size() < options_.pipeline &&
+           (!open_loop || !backlog_.empty())) {
+      if (open_loop) {
+        connection.started.push_back(backlog_.front());
+        backlog_.pop_front();
+      } else {
+        connection.started.push_back(now);
+      }
+      connection.out += requests_[connection.next_request];
+      connection.next_request = (connection.next_request + 1) %
+                                requests_.size();
+    }
+    if (connection.started.size() != queued) {
+      flush(id);
+    }
+  }
+
+  void flush(std::size_t id) {
+    auto& connection = connections_[id];
+    while (connection.out_sent < connection.out.size()) {
+      const auto written =
+          ::send(connection.fd, connection.out.data() + connection.out_sent,
+                 connection.out.size() - connection.out_sent, MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          watchWrites(id, true);
+          return;
+        }
+        reconnect(id);
+        return;
+      }
+      connection.out_sent += static_cast<std::size_t>(written);
+    }
+    connection.out.clear();
+    connection.out_sent = 0;
+    watchWrites(id, false);
+  }
+
+  void watchWrites(std::size_t id, bool enable) {
+    auto& connection = connections_[id];
+    if (connection.want_write == enable) {
+      return;
+    }
+    connection.want_write = enable;
+    epoll_event event{.events = EPOLLIN | (enable ? EPOLLOUT : 0u),
+                      .data = {.u64 = id}};
+    ::epoll_ctl(epoll_, EPOLL_CTL_MOD, connection.fd, &event);
+  }
+
+  void receive(std::size_t id, clock::time_point now) {
+    auto& connection = connections_[id];
+    std::array<char, 64 * 1024> buffer;
+    while (true) {
+      const auto received =
+          ::recv(connection.fd, buffer.data(), buffer.size(), 0);
+      if (received > 0) {
+        connection.in.append(buffer.data(), static_cast<std::size_t>(received));
+        continue;
+      }
+      if (received < 0 && errno == EINTR) {
+        continue;
+      }
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      }
+      parseResponses(connection, now);
+      reconnect(id);
+      return;
+    }
+    if (parseResponses(connection, now)) {
+      reconnect(id);
+    }
+  }
+
+  // Consumes every complete response. Returns true when the server said it
+  // closes the connection.
+  bool parseResponses(Connection& connection, clock::time_point now) {
+    bool close = false;
+    while (!close && !connection.started.empty()) {
+      const std::string_view pending =
+          std::string_view(connection.in).substr(connection.in_parsed);
+      const auto head_end = pending.find("\r\n\r\n");
+      if (head_end == pending.npos) {
+        break;
+      }
+      const auto head = parseHead(pending.substr(0, head_end));
+      const auto length = head_end + 4 + head.content_length;
+      if (pending.size() < length) {
+        break;
+      }
+      connection.in_parsed += length;
+      close = head.close;
+
+      const auto started = connection.started.front();
+      connection.started.pop_front();
+      if (started >= measure_from_ && now <= until_) {
+        ++totals_.responses;
+        if (head.status < 200 || head.status >= 300) {
+          ++totals_.non_2xx;
+        }
+        histogram_.record(now - started);
+      }
+    }
+    if (connection.in_parsed == connection.in.size()) {
+      connection.in.clear();
+      connection.in_parsed = 0;
+    }
+    return close;
+  }
+
+  void armTimer(clock::time_point due) {
+    const auto since_epoch = due.time_since_epoch();
+    const auto secs = std::chrono::floor<std::chrono::seconds>(since_epoch);
+    itimerspec spec{};
+    spec.it_value.tv_sec = secs.count();
+    spec.it_value.tv_nsec =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch -
+                                                             secs)
+            .count();
+    ::timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+  }
+};
+
+std::string formatDuration(std::chrono::nanoseconds duration) {
+  const auto ns = static_cast<double>(duration.count());
+  if (ns >= 1e9) return fmt::format("{:.2f}s", ns / 1e9);
+  if (ns >= 1e6) return fmt::format("{:.2f}ms", ns / 1e6);
+  if (ns >= 1e3) return fmt::format("{:.1f}us", ns / 1e3);
+  return fmt::format("{:.0f}ns", ns);
+}
+
+// In the layout of HdrHistogram's outputPercentileDistribution(): one line
+// per non-empty bucket, with values in microseconds.
+void printDistribution(const httpxx::HistogramSnapshot& latency) {
+  const auto total = latency.count();
+  fmt::print("{:>12} {:>14} {:>10} {:>14}\n\n", "Value(us)", "Percentile",
+             "TotalCount", "1/(1-Percentile)");
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < httpxx::HistogramBuckets::count; ++i) {
+    const auto count = latency.bucketCount(i);
+    if (count == 0) {
+      continue;
+    }
+    seen += count;
+    const double percentile =
+        static_cast<double>(seen) / static_cast<double>(total);
+    const auto value =
+        static_cast<double>(httpxx::HistogramBuckets::highest(i)) / 1e3;
+    if (seen == total) {
+      fmt::print("{:>12.3f} {:>14.12f} {:>10}\n", value, percentile, seen);
+    } else {
+      fmt::print("{:>12.3f} {:>14.12f} {:>10} {:>14.2f}\n", value, percentile,
+                 seen, 1.0 / (1.0 - percentile));
+    }
+  }
+  fmt::print("\n");
+}
+
+void appendJson(const Options& options, std::string_view mode, double rps,
+                const httpxx::HistogramSnapshot& latency,
+                const Totals& totals) {
+  const char* path = std::getenv("HTTPXX_BENCH_JSON");
+  if (path == nullptr || *path == '\0') {
+    return;
+  }
+  const auto line = fmt::format(
+      "{{\"suite\":\"load\",\"name\":\"{} {} c{} p{}\",\"rate\":{},"
+      "\"requests_per_second\":{:.1f},\"p50_ns\":{},\"p99_ns\":{},"
+      "\"p999_ns\":{},\"max_ns\":{},\"non_2xx\":{},\"errors\":{}}}\n",
+      options.scenario, mode, options.connections, options.pipeline,
+      options.rate, rps, latency.percentile(0.5).count(),
+      latency.percentile(0.99).count(), latency.percentile(0.999).count(),
+      latency.percentile(1.0).count(), totals.non_2xx, totals.errors);
+  const int fd = ::open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1 || ::write(fd, line.data(), line.size()) !=
+                      static_cast<ssize_t>(line.size())) {
+    std::cerr << fmt::format("httpxx-bench: cannot write {}\n", path);
+  }
+  if (fd != -1) {
+    ::close(fd);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    const auto options = parseOptions(argc, argv);
+    const auto requests = scenarioRequests(
+        options.scenario, fmt::format("{}:{}", options.host, options.port));
+    socklen_t address_length = 0;
+    const auto address = resolve(options, address_length);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t t = 0; t < options.threads; ++t) {
+      const auto connections =
+          options.connections / options.threads +
+          (t < options.connections % options.threads ? 1 : 0);
+      workers.push_back(std::make_unique<Worker>(
+          options, requests, address, address_length, connections,
+          options.rate * static_cast<double>(connections) /
+              static_cast<double>(options.connections)));
+    }
+
+    const std::string_view mode = options.rate > 0 ? "open" : "closed";
+    fmt::print("httpxx-bench: {} against {}:{}, {} connections, pipeline {}, "
+               "{} loop{}\n",
+               options.scenario, options.host, options.port,
+               options.connections, options.pipeline, mode,
+               options.rate > 0 ? fmt::format(" at {} req/s", options.rate)
+                                : "");
+
+    const auto start = clock::now();
+    const auto measure_from = start + options.warmup;
+    const auto until = measure_from + options.duration;
+    {
+      std::vector<std::jthread> threads;
+      for (auto& worker : workers) {
+        threads.emplace_back([&worker, start, measure_from, until] {
+          worker->run(start, measure_from, until);
+        });
+      }
+    }
+
+    httpxx::HistogramSnapshot latency;
+    Totals totals;
+    for (const auto& worker : workers) {
+      worker->collect(latency, totals);
+    }
+    const auto rps =
+        static_cast<double>(totals.responses) /
+        std::chrono::duration<double>(options.duration).count();
+
+    fmt::print("  requests  {} ({:.1f}/s), {} non-2xx, {} errors, {} "
+               "reconnects\n",
+               totals.responses, rps, totals.non_2xx, totals.errors,
+               totals.reconnects);
+    fmt::print("  latency  ");
+    for (const auto& [label, q] :
+         {std::pair{"p50", 0.5}, std::pair{"p90", 0.9}, std::pair{"p99", 0.99},
+          std::pair{"p99.9", 0.999}, std::pair{"p99.99", 0.9999}}) {
+      fmt::print(" {} {}", label, formatDuration(latency.percentile(q)));
+    }
+    fmt::print(" max {}\n", formatDuration(latency.percentile(1.0)));
+    if (options.histogram) {
+      fmt::print("\n");
+      printDistribution(latency);
+    }
+    appendJson(options, mode, rps, latency, totals);
+  } catch (const std::exception& e) {
+    std::cerr << "httpxx-bench: " << e.what() << '\n';
+    std::cerr << usage;
+    return 1;
+  }
+  return 0;
+}
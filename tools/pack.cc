@@ -0,0 +1,25 @@
+#include <filesystem>
+#include <httpxx/asset_pack.hh>
+#include <iostream>
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " <www_path> <output.pack>\n";
+    return 2;
+  }
+
+  try {
+    auto writer = httpxx::AssetPackWriter::fromDirectory(argv[1]);
+    writer.write(argv[2]);
+
+    auto pack = httpxx::AssetPack::open(argv[2]);
+    std::clog << fmt::format("Packed {} files from {} into {} ({} bytes)\n",
+                             pack->size(), argv[1], argv[2],
+                             std::filesystem::file_size(argv[2]));
+  } catch (const std::exception& e) {
+    std::cerr << "httpxx-pack: " << e.what() << '\n';
+    return 1;
+  }
+
+  return 0;
+}
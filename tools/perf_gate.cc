@@ -0,0 +1,246 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// Compares benchmark results, as written through HTTPXX_BENCH_JSON, with a
+// baseline. Both files hold several runs of every benchmark. A metric
+// regresses when a one-sided Mann-Whitney U test says the current runs are
+// worse than the baseline's at significance --alpha, and their medians differ
+// by more than the tolerance for that metric, so noise alone does not fail
+// the gate and neither do significant but negligible changes. A baseline
+// metric the current runs no longer report fails the gate too, since a
+// benchmark that stopped running cannot show a regression.
+
+namespace {
+
+constexpr std::string_view usage =
+    "usage: httpxx-perf-gate BASELINE CURRENT [options]\n"
+    "  --alpha P             significance level (default 0.05)\n"
+    "  --tolerance F         allowed slowdown of ns_per_op and throughput\n"
+    "                        (default 0.05)\n"
+    "  --tail-tolerance F    allowed growth of p99 latency (default 0.10)\n";
+
+struct Options {
+  std::string baseline;
+  std::string current;
+  double alpha{0.05};
+  double tolerance{0.05};
+  double tail_tolerance{0.10};
+};
+
+// One number each benchmark is judged by. Microbenchmarks report ns_per_op;
+// load tests report throughput and tail latency.
+struct Metric {
+  std::string_view field;
+  bool higher_is_better;
+  double Options::*tolerance;
+};
+
+constexpr std::array metrics{
+    Metric{"ns_per_op", false, &Options::tolerance},
+    Metric{"requests_per_second", true, &Options::tolerance},
+    Metric{"p99_ns", false, &Options::tail_tolerance},
+};
+
+using Key = std::tuple<std::string, std::string, std::string_view>;
+using Samples = std::map<Key, std::vector<double>>;
+
+Samples load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error(fmt::format("cannot read {}", path));
+  }
+  Samples samples;
+  std::string line;
+  for (std::size_t number = 1; std::getline(in, line); ++number) {
+    if (line.empty()) {
+      continue;
+    }
+    try {
+      const auto result = nlohmann::json::parse(line);
+      for (const auto& metric : metrics) {
+        if (result.contains(metric.field)) {
+          samples[{result.at("suite"), result.at("name"), metric.field}]
+              .push_back(result.at(metric.field).get<double>());
+        }
+      }
+    } catch (const nlohmann::json::exception& e) {
+      throw std::runtime_error(
+          fmt::format("{}:{}: {}", path, number, e.what()));
+    }
+  }
+  return samples;
+}
+
+double median(std::vector<double> values) {
+  std::ranges::sort(values);
+  const auto middle = values.size() / 2;
+  return values.size() % 2 == 1
+             ? values[middle]
+             : (values[middle - 1] + values[middle]) / 2;
+}
+
+// Probability of seeing the current samples this much larger than the
+// baseline if both came from the same distribution: the one-sided p-value
+// of the Mann-Whitney U test, by the normal approximation with tie and
+// continuity corrections. Callers flip the signs when larger is better.
+double mannWhitneyGreater(const std::vector<double>& baseline,
+                          const std::vector<double>& current) {
+  struct Rank {
+    double value;
+    bool current;
+  };
+  std::vector<Rank> all;
+  for (const auto value : baseline) all.push_back({value, false});
+  for (const auto value : current) all.push_back({value, true});
+  std::ranges::sort(all, {}, &Rank::value);
+
+  const auto n1 = static_cast<double>(current.size());
+  const auto n2 = static_cast<double>(baseline.size());
+  const auto n = n1 + n2;
+  double rank_sum = 0;
+  double ties = 0;
+  for (std::size_t i = 0; i < all.size();) {
+    auto j = i;
+    while (j < all.size() && all[j].value == all[i].value) {
+      ++j;
+    }
+    const auto average_rank = static_cast<double>(i + j + 1) / 2;
+    const auto tied = static_cast<double>(j - i);
+    ties += tied * tied * tied - tied;
+    for (auto k = i; k < j; ++k) {
+      if (all[k].current) rank_sum += average_rank;
+    }
+    i = j;
+  }
+
+  const auto u = rank_sum - n1 * (n1 + 1) / 2;
+  const auto mean = n1 * n2 / 2;
+  const auto variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) {
+    return 1.0;
+  }
+  const auto z = (u - mean - 0.5) / std::sqrt(variance);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      std::cout << usage;
+      std::exit(0);
+    }
+    if (!arg.starts_with("--")) {
+      files.emplace_back(arg);
+      continue;
+    }
+    if (i + 1 == argc) {
+      throw std::invalid_argument(fmt::format("{} needs a value", arg));
+    }
+    const double value = std::stod(argv[++i]);
+    if (arg == "--alpha") {
+      options.alpha = value;
+    } else if (arg == "--tolerance") {
+      options.tolerance = value;
+    } else if (arg == "--tail-tolerance") {
+      options.tail_tolerance = value;
+    } else {
+      throw std::invalid_argument(fmt::format("unknown option {}", arg));
+    }
+  }
+  if (files.size() != 2) {
+    throw std::invalid_argument("expected a baseline and a current file");
+  }
+  options.baseline = files[0];
+  options.current = files[1];
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    const auto options = parseOptions(argc, argv);
+    const auto baseline = load(options.baseline);
+    const auto current = load(options.current);
+
+    std::size_t regressions = 0;
+    std::size_t missing = 0;
+    fmt::print("{:<56} {:>12} {:>12} {:>8} {:>7}  {}\n", "benchmark",
+               "baseline", "current", "change", "p", "verdict");
+    for (const auto& [key, before] : baseline) {
+      const auto& [suite, name, field] = key;
+      const auto label = fmt::format("{}/{} {}", suite, name, field);
+      const auto found = current.find(key);
+      if (found == current.end()) {
+        fmt::print("{:<56} {:>12.1f} {:>12} {:>8} {:>7}  MISSING\n", label,
+                   median(before), "-", "-", "-");
+        ++missing;
+        continue;
+      }
+      const auto& after = found->second;
+      const auto& metric = *std::ranges::find(metrics, field, &Metric::field);
+
+      const auto old_median = median(before);
+      const auto new_median = median(after);
+      const auto change =
+          old_median == 0 ? 0 : (new_median - old_median) / old_median;
+      // Positive when the current runs are worse.
+      const auto worse = metric.higher_is_better ? -change : change;
+
+      std::vector<double> flipped_before = before;
+      std::vector<double> flipped_after = after;
+      if (metric.higher_is_better) {
+        for (auto& value : flipped_before) value = -value;
+        for (auto& value : flipped_after) value = -value;
+      }
+      const auto p = mannWhitneyGreater(flipped_before, flipped_after);
+
+      std::string_view verdict = "ok";
+      if (p < options.alpha && worse > options.*metric.tolerance) {
+        verdict = "REGRESSION";
+        ++regressions;
+      } else if (mannWhitneyGreater(flipped_after, flipped_before) <
+                     options.alpha &&
+                 -worse > options.*metric.tolerance) {
+        verdict = "improved";
+      }
+      fmt::print("{:<56} {:>12.1f} {:>12.1f} {:>+7.1f}% {:>7.3f}  {}\n",
+                 label, old_median, new_median, change * 100, p, verdict);
+    }
+    for (const auto& [key, after] : current) {
+      if (!baseline.contains(key)) {
+        const auto& [suite, name, field] = key;
+        fmt::print("{:<56} {:>12} {:>12.1f} {:>8} {:>7}  new\n",
+                   fmt::format("{}/{} {}", suite, name, field), "-",
+                   median(after), "-", "-");
+      }
+    }
+
+    if (regressions != 0 || missing != 0) {
+      std::cerr << fmt::format(
+          "httpxx-perf-gate: {} regression(s), {} missing\n", regressions,
+          missing);
+      return 1;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "httpxx-perf-gate: " << e.what() << '\n' << usage;
+    return 2;
+  }
+  return 0;
+}
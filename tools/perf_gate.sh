@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# Performance regression gate. Runs every microbenchmark and a set of
+# httpxx-bench load tests RUNS times, then compares the results with the
+# baseline using httpxx-perf-gate, which gets any further arguments. Exits
+# non-zero on a regression. When there is no baseline yet, or with --update,
+# the results become the baseline instead.
+#
+# usage: tools/perf_gate.sh BUILD_DIR [--update | httpxx-perf-gate options]
+#
+# Baselines only compare on the machine they were recorded on, so the
+# baseline lives in the build directory (BASELINE overrides this) rather than
+# in the repository.
+set -euo pipefail
+
+root="$(cd "$(dirname "$0")/.." && pwd)"
+build="$(cd "${1:?usage: $0 BUILD_DIR [--update | gate options]}" && pwd)"
+shift
+runs="${RUNS:-5}"
+baseline="${BASELINE:-$build/perf-baseline.jsonl}"
+results="$(mktemp --suffix=.jsonl)"
+server=
+cleanup() {
+  rm -f "$results"
+  if [[ -n "$server" ]]; then kill "$server" 2>/dev/null || true; fi
+}
+trap cleanup EXIT
+
+export HTTPXX_BENCH_JSON="$results"
+
+for run in $(seq "$runs"); do
+  echo "== microbenchmarks, run $run/$runs"
+  for bench in "$build"/benchmarks/bench_*; do
+    [[ -x "$bench" ]] && "$bench" > /dev/null
+  done
+done
+
+# The example app answers /api/tasks and serves example/static.
+(cd "$root/example" && exec "$build/example") > /dev/null 2>&1 &
+server=$!
+sleep 1
+for run in $(seq "$runs"); do
+  echo "== load tests, run $run/$runs"
+  for scenario in tasks static spa; do
+    "$build/httpxx-bench" --scenario "$scenario" --connections 16 \
+      --duration 5 --warmup 1 > /dev/null
+  done
+done
+kill "$server"
+wait "$server" 2>/dev/null || true
+server=
+
+if [[ "${1:-}" == "--update" || ! -e "$baseline" ]]; then
+  cp "$results" "$baseline"
+  echo "baseline written to $baseline"
+  exit 0
+fi
+"$build/httpxx-perf-gate" "$baseline" "$results" "$@"